@@ -0,0 +1,231 @@
+
+/* Diffusion Limited Aggregation in three dimensions */
+
+// g++ -O2 DLA_3d.cpp -o DLA_3d
+// DLA_3d [--seed N] [--particles N] [--size N] [cluster.txt]
+//
+// The center-seeded model of DiffusionLimitedAggregation.cpp on a cubic
+// lattice, headless: walkers are launched one at a time on a sphere just
+// outside the cluster, step to one of their 6 neighbours and are launched
+// again past the kill sphere. Far from the cluster they jump, as with
+// --hop in 2D: to a random point of the largest sphere around them that
+// cannot touch it, which is where a walk from its center would first
+// leave it.
+// The lattice is a cube of --size sites a side around the seed, held as
+// bits (voxel_grid.h): one bit per site for the sticking test and 1/7 bit
+// for the pyramid giving the jumps. By default it is sized for
+// --particles: 10^5 particles get a cube of 564 sites (27 MB), 10^6 of
+// 1322 (340 MB), 10^7 of 3220 (4.9 GB).
+
+#include <iostream>
+#include <fstream>
+#include <chrono>
+#include <cmath>
+#include <ctime>
+#include <cstdlib>
+#include <algorithm>
+
+#include "rng.h"
+#include "config.h"
+#include "arena.h"
+#include "voxel_grid.h"
+
+#define MAX_PARTICLE 100000
+#define DOT_RADIUS 1
+#define OVERLAP_TOL 0
+
+// shorter jumps are not worth the sqrt and the trigonometry
+const float HOP_MIN = 4;
+
+struct Voxel {
+    int x, y, z;
+};
+
+struct Aggregation3d {
+    int maxParticle = MAX_PARTICLE;
+    int dotRadius = DOT_RADIUS;
+    float overlapTol = OVERLAP_TOL;
+    int size = 0; // side of the lattice, 0 for one sized from maxParticle
+    uint64_t seed = std::time(0);
+
+    VoxelGrid grid;
+    VoxelPyramid pyramid;
+    int hopLevel = 1;
+    Arena<Voxel> fixedParticles; // room for maxParticle
+    Rng rng;
+    // distance of the farthest particle from the seed
+    float farthest = 0;
+    bool full = false; // the cluster reached the edge of the lattice
+
+    // totals
+    uint64_t walkerSteps = 0, jumps = 0, launches = 0;
+
+    float collision_distance() const {
+        return dotRadius*2 - overlapTol;
+    }
+    float launch_radius() const {
+        return farthest + collision_distance() + 2;
+    }
+    float kill_radius() const {
+        return 4*farthest + 50;
+    }
+
+    bool finished() const {
+        return (int)fixedParticles.size() >= maxParticle || full;
+    }
+
+    void init() {
+        if (!size) {
+            // 3D DLA grows as N^(1/2.5), with room to spare
+            size = 64 + 2*(int)std::ceil(2.5*std::pow((double)maxParticle, 0.4));
+        }
+        grid.init(-size/2, size, collision_distance());
+        pyramid.init(-size/2, size);
+        hopLevel = 1;
+        while ((2 << (hopLevel-1)) < HOP_MIN + collision_distance() + 1)
+            hopLevel++;
+        rng.seed(seed, 0);
+        fixedParticles.reserve(maxParticle);
+        fixedParticles.clear();
+        farthest = 0;
+        fix(Voxel {0, 0, 0});
+    }
+
+    void fix(const Voxel& p) {
+        fixedParticles.push_back(p);
+        grid.add(p.x, p.y, p.z);
+        pyramid.add(p.x, p.y, p.z);
+        farthest = std::max(farthest, std::sqrt((float)p.x*p.x + (float)p.y*p.y + (float)p.z*p.z));
+        // the sticky shell must stay on the lattice
+        if (farthest + collision_distance() + 2 >= size/2)
+            full = true;
+    }
+
+    // p + a uniform point of the sphere of radius r, rounded to the lattice
+    Voxel on_sphere(Voxel p, float r) {
+        double z = 2*rng.uniform() - 1;
+        double phi = 6.2831853*rng.uniform();
+        double s = std::sqrt(1 - z*z);
+        p.x += (int)std::lround(r*s*std::cos(phi));
+        p.y += (int)std::lround(r*s*std::sin(phi));
+        p.z += (int)std::lround(r*z);
+        return p;
+    }
+
+    // one of the 6 neighbours
+    void step(Voxel& p) {
+        unsigned d;
+        do {
+            d = rng.take(3);
+        } while (d >= 6);
+        int sign = (d & 1) ? 1 : -1;
+        if (d < 2)
+            p.x += sign;
+        else if (d < 4)
+            p.y += sign;
+        else
+            p.z += sign;
+    }
+
+    // walks one particle until it sticks
+    void add_particle() {
+        Voxel p = on_sphere(Voxel {0, 0, 0}, launch_radius());
+        launches++;
+        float kill = kill_radius();
+        // past this the sphere around the cluster allows a jump
+        float far = farthest + HOP_MIN + collision_distance() + 1;
+        while (!grid.touches(p.x, p.y, p.z)) {
+            walkerSteps++;
+            float r2 = (float)p.x*p.x + (float)p.y*p.y + (float)p.z*p.z;
+            if (r2 > kill*kill) {
+                p = on_sphere(Voxel {0, 0, 0}, launch_radius());
+                launches++;
+                continue;
+            }
+            // outside of the cluster the radius alone gives the bound
+            float bound = r2 > far*far ? std::sqrt(r2) - farthest
+                                       : pyramid.distance_bound(p.x, p.y, p.z, hopLevel);
+            float length = bound - collision_distance() - 1;
+            if (length >= HOP_MIN) {
+                p = on_sphere(p, length);
+                jumps++;
+            }
+            else {
+                step(p);
+            }
+        }
+        fix(p);
+    }
+
+    double gyration() const {
+        double sx(0), sy(0), sz(0), r2(0);
+        for (const Voxel& p : fixedParticles) {
+            sx += p.x;
+            sy += p.y;
+            sz += p.z;
+            r2 += (double)p.x*p.x + (double)p.y*p.y + (double)p.z*p.z;
+        }
+        double n = fixedParticles.size();
+        sx /= n;
+        sy /= n;
+        sz /= n;
+        return std::sqrt(std::max(0.0, r2/n - sx*sx - sy*sy - sz*sz));
+    }
+};
+
+Aggregation3d dla;
+
+// one "x y z" line per fixed particle, in the order they stuck
+bool save_cluster(const char* path) {
+    std::ofstream file(path);
+    for (const Voxel& p : dla.fixedParticles) {
+        file << p.x << " " << p.y << " " << p.z << "\n";
+    }
+    return (bool)file;
+}
+
+int main(int argc, char **argv) {
+    const char* path = parse_command_line(argc, argv, {},
+        [](const std::string& name, const char* value) {
+            if (!value)
+                return false;
+            if (name == "seed")
+                dla.seed = std::strtoull(value, nullptr, 10);
+            else if (name == "particles")
+                dla.maxParticle = std::max(1, (int)std::atof(value));
+            else if (name == "size")
+                dla.size = std::max(16, std::atoi(value));
+            else if (name == "dot-radius")
+                dla.dotRadius = std::max(1, std::atoi(value));
+            else if (name == "overlap")
+                dla.overlapTol = std::atof(value);
+            else
+                return false;
+            return true;
+        });
+    if (!path)
+        path = "DLA_3d.txt";
+    std::cout << "Seed " << dla.seed << "\n";
+    dla.init();
+
+    auto start(std::chrono::steady_clock::now());
+    while (!dla.finished()) {
+        dla.add_particle();
+    }
+    auto stop(std::chrono::steady_clock::now());
+    auto duration(std::chrono::duration_cast<std::chrono::milliseconds>(stop-start));
+    std::cout << "Finished in " << duration.count() << "ms\n";
+    if (dla.full)
+        std::cerr << "The cluster reached the edge of the " << dla.size
+                  << " lattice after " << dla.fixedParticles.size() << " particles, use a larger --size\n";
+    std::cout << dla.fixedParticles.size() << " particles, radius " << dla.farthest
+              << ", radius of gyration " << dla.gyration() << ", "
+              << dla.walkerSteps << " steps, " << dla.jumps << " jumps, "
+              << dla.launches << " launches\n";
+
+    if (!save_cluster(path)) {
+        std::cerr << "Cannot write " << path << "\n";
+        return 1;
+    }
+    return 0;
+}
@@ -1,8 +1,13 @@
 
 /* Diffusion Limited Aggregation */
 
+#ifndef HEADLESS
+#define GL_GLEXT_PROTOTYPES
 #include <GL/gl.h>
-#include <GL/glut.h>
+#include <GL/freeglut.h>
+#include "gl_buffer.h"
+#include "sim_thread.h"
+#endif
 
 #include <iostream>
 #include <cstdio>
@@ -11,6 +16,9 @@
 #include <random>
 #include <ctime>
 
+#include "dla_core.h"
+#include "dla_geometry.h"
+
 #define WIDTH 600
 #define HEIGHT 600
 #define FPS 1
@@ -24,150 +32,46 @@
 #define SPEED 2
 #define OVERLAP_TOL 0
 
-const float COLLISION_DISTANCE = RADIUS*2-OVERLAP_TOL;
-// avoid the sqrt each for each distance calculus
-const float COLLISION_DISTANCE2 = COLLISION_DISTANCE*COLLISION_DISTANCE;
-
-struct Particle {
-    int x, y;
-    void go() {
-        x += (rand()%2) ? 1 : -1;
-        y += (rand()%2) ? 1 : -1;
-    }
-    void border_control() {
-        if (x<-WIDTH/2)
-            x=-WIDTH/2;
-        else if (x>WIDTH/2)
-            x=WIDTH/2;
-        if (y<-HEIGHT/2)
-            y=-HEIGHT/2;
-        else if (y>HEIGHT/2)
-            y=HEIGHT/2;
-    }
-};
-
-
-bool is_collision(Particle& A, Particle& B);
-void init_particles ();
-void add_new_particle(int n);
-void check_collisions();
-void update_particles();
-void check_out_of_bound();
-void draw_dot(float x, float y);
-
-Particle fixedParticles[MAX_PARTICLE];
-Particle movingParticles[MAX_SIMULTANEOUS];
-
-int currentTotalParticles(0); // current amount of particles in screen
-int totalFixedParticles(0);
-
-// distance of the farthest particle from the center
-float farthest(10);
-
-
-bool is_collision(Particle& A, Particle& B) {
-    float X(A.x - B.x), Y(A.y - B.y);
-    if (std::abs(X) > COLLISION_DISTANCE)
-        return false;
-    else if (std::abs(Y) > COLLISION_DISTANCE)
-        return false;
-    return X*X + Y*Y < COLLISION_DISTANCE2;
-}
-
-float distance_from_center(Particle& p) {
-    return std::sqrt(p.x*p.x + p.y*p.y);
-}
-
-void init_particles () {
-    fixedParticles[0] = Particle {0, 0};
-    totalFixedParticles++;
-    currentTotalParticles++;
-    for (int i=0; i<MAX_SIMULTANEOUS; i++) {
-        add_new_particle(i);
-    }
-}
-
-void add_new_particle(int n) {
-    if (totalFixedParticles >= MAX_PARTICLE)
-        return;
-    Particle P;
-    
-    int radius = farthest+10;
-    float angle = rand()%360;
-    angle *= PI / 180.0;
-    
-    P = {(int)(radius*std::cos(angle)), (int)(radius*std::sin(angle))};
-    movingParticles[n] = P;
-    currentTotalParticles++;
-}
-
-void check_collisions() {
-    // the total can be slightly exceeded but this check is done
-    // here for optimization purposes
-    if (totalFixedParticles >= MAX_PARTICLE-1)
-        return;
-    float tempDist;
-    // i for the free and j for the fixed
-    for (int j=0; j<MAX_SIMULTANEOUS; j++) {
-        tempDist = distance_from_center(movingParticles[j]);
-        if (tempDist > farthest+RADIUS)
-            continue;
-        for (int i=totalFixedParticles-1; i>=0; i--) {
-            if (is_collision(fixedParticles[i], movingParticles[j])) {
-                fixedParticles[totalFixedParticles] = movingParticles[j];
-                totalFixedParticles++;
-                if (tempDist > farthest)
-                    farthest = tempDist+RADIUS;
-                add_new_particle(j);
-                break;
-            }
-        }
-    }
-}
+Aggregation<CenterSeed> dla({WIDTH, HEIGHT, MAX_PARTICLE, MAX_SIMULTANEOUS,
+                             RADIUS, OVERLAP_TOL, 0, FPS});
 
-void update_particles() {
-    for (int i=0; i<MAX_SIMULTANEOUS; i++) {
-        movingParticles[i].go();
-        movingParticles[i].border_control();
-    }
-}
+#ifndef HEADLESS
 
-void check_out_of_bound() {
-    for (int i=0; i<MAX_SIMULTANEOUS; i++) {
-        if (distance_from_center(movingParticles[i]) > farthest+20)
-            add_new_particle(i);
-    }
-}
+// the cluster only grows, a frame uploads the new particles and draws them
+// all in one call
+VertexBuffer cluster;
+SimulationThread<Aggregation<CenterSeed>> simulation(dla);
 
 void draw_dot(float x, float y) {
     glBegin(GL_POLYGON);
     for (float i=0; i<TWO_PI; i+=TWO_PI/10) {
-        glVertex2f(x + std::cos(i)*RADIUS, y + std::sin(i)*RADIUS);
+        glVertex2f(x + std::cos(i)*dla.settings.dotRadius, y + std::sin(i)*dla.settings.dotRadius);
     }
     glEnd();
 }
 
 void init() {
     glClearColor(0.1, 0.1, 0.1, 1.0);
-    std::srand(std::time(0));
-    init_particles();
+    if (!dla.start())
+        std::exit(1);
+    std::cout << "Seed " << dla.seed << "\n";
+    simulation.start(10000, false);
 }
 
 void display_callback() {
     glClear (GL_COLOR_BUFFER_BIT);
 
+    add_points(cluster, dla.fixedParticles, simulation.fixed());
+    cluster.upload();
     glColor3f(1.0, 1.0, 1.0);
     glPointSize(1);
-    glBegin(GL_POINTS);
-    for (int i=0; i<totalFixedParticles; i++) {
-        glVertex2f(fixedParticles[i].x, fixedParticles[i].y);
+    cluster.draw(GL_POINTS);
+    /*glBegin(GL_POINTS);
+    for (int i=0; i<dla.settings.maxSimultaneous; i++) {
+        Particle p = dla.walker(i);
+        glVertex2f(p.x, p.y);
     }
-    /*for (int i=0; i<MAX_SIMULTANEOUS; i++) {
-        glVertex2f(movingParticles[i].x, movingParticles[i].y);
-    }*/
-    
-
-    glEnd();
+    glEnd();*/
     glFlush();
     glutSwapBuffers();
 }
@@ -176,44 +80,49 @@ void reshape_callback(int width, int height) {
     glViewport(0, 0, (GLsizei)width, (GLsizei) height);
     glMatrixMode(GL_PROJECTION);
     glLoadIdentity();
-    glOrtho(-WIDTH/2, WIDTH/2,
-            -HEIGHT/2, HEIGHT/2,
+    glOrtho(-dla.settings.width/2, dla.settings.width/2,
+            -dla.settings.height/2, dla.settings.height/2,
             -1.0, 0.0);
     glMatrixMode(GL_MODELVIEW);
 }
 
+// the simulation runs on its own thread, this only refreshes the window
 void timer_callback(int) {
-    if (totalFixedParticles >= MAX_PARTICLE-1) {
+    glutPostRedisplay(); // run the display_callback function
+    if (simulation.finished()) {
+        dla.finish();
         std::cout << "Finished\n";
         return;
     }
-    auto start(std::chrono::steady_clock::now());
-    
-    for (int i=0; i<10000; i++) {
-        check_collisions();
-        update_particles();
-    }
-    check_out_of_bound();
-    
-    glutPostRedisplay(); // run the display_callback function
-    
-    auto stop(std::chrono::steady_clock::now());
-    auto duration(std::chrono::duration_cast<std::chrono::milliseconds>(stop-start));
-    std::cout << duration.count() << "ms\n";
-    glutTimerFunc(1000/FPS, timer_callback, 0);
+    glutTimerFunc(1000/dla.settings.fps, timer_callback, 0);
 }
 
 int main(int argc, char **argv) {
     glutInit(&argc, argv); // initialize
+    parse_options(argc, argv, dla);
     glutInitDisplayMode(GLUT_RGB | GLUT_DOUBLE);
     glutInitWindowPosition(15, 15); // optional
-    glutInitWindowSize(WIDTH, HEIGHT);
+    glutInitWindowSize(dla.settings.width, dla.settings.height);
     glutCreateWindow("Diffusion-Limited Aggregation");
+    // closing the window returns from glutMainLoop rather than exiting
+    glutSetOption(GLUT_ACTION_ON_WINDOW_CLOSE, GLUT_ACTION_GLUTMAINLOOP_RETURNS);
     glutDisplayFunc(display_callback);
     glutReshapeFunc(reshape_callback);
-    glutTimerFunc(1000/FPS, timer_callback, 0);
+    glutTimerFunc(1000/dla.settings.fps, timer_callback, 0);
     init();
     glutMainLoop();
+    // the encoder is joined before the statics it uses are destroyed
+    simulation.stop();
+    dla.finish();
 
     return 0;
 }
+
+#else
+
+// headless build: g++ -O2 -DHEADLESS DiffusionLimitedAggregation.cpp
+int main(int argc, char **argv) {
+    return run_headless(dla, 10000, argc, argv, "DiffusionLimitedAggregation.txt");
+}
+
+#endif
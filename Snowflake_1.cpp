@@ -6,15 +6,28 @@
 */
 
 
+#ifndef HEADLESS
+#define GL_GLEXT_PROTOTYPES
 #include <GL/gl.h>
 #include <GL/glut.h>
+#include "gl_buffer.h"
+#endif
 
 #include <iostream>
 #include <cstdio>
 #include <chrono>
 #include <cmath>
-#include <random>
 #include <ctime>
+#include <cstring>
+#include <cstdlib>
+#include <fstream>
+#include <vector>
+#include <algorithm>
+
+#include "rng.h"
+#include "stats.h"
+#include "config.h"
+#include "arena.h"
 
 #define WIDTH 600
 #define HEIGHT 600
@@ -30,17 +43,37 @@
 #define DOT_RADIUS 4
 #define SPEED 1
 #define OVERLAP_TOL 0 // in pixels
-#define COLLISION_DISTANCE DOT_RADIUS*2 - OVERLAP_TOL
 
 
+// the #defines are the defaults, see parse_options
+int width(WIDTH), height(HEIGHT), fps(FPS);
+int maxParticle(MAX_PARTICLE);
+int maxSimultaneous(MAX_SIMULTANEOUS);
+int dotRadius(DOT_RADIUS);
+float speed(SPEED), overlapTol(OVERLAP_TOL);
+float collisionDistance(DOT_RADIUS*2 - OVERLAP_TOL);
+
+// one stream is enough, there is one walker at a time
+Rng rng;
+uint64_t seed = std::time(0);
+
+// with -DDLA_STATS, a tick is one check_collisions + update_particles; the
+// commit time is the fixing of the walkers that stick, the tests are counted
+// but not timed
+Stats stats;
+
 struct Particle {
     float radius;
     float angle;
     bool isFixed;
+    // set when it sticks: the position and the particle it stuck to (-1
+    // for the seed)
+    float x, y;
+    int bond;
     void update() {
-        radius -= SPEED;
-        double a = PI3 * (rand()%100) / 3500;
-        angle += (rand()%2) ? -a : a;
+        radius -= speed;
+        double a = PI3 * rng.below(100) / 3500;
+        angle += rng.bit() ? -a : a;
     }
     void border_control() {
         if (angle > PI/6)
@@ -52,126 +85,262 @@ struct Particle {
 };
 
 
-bool is_collision(Particle& A, Particle& B);
 void init_particles ();
 void add_new_particle();
 void check_collisions();
 void update_particles();
-void draw_particle(Particle& p);
 
 
-Particle allParticles[MAX_PARTICLE];
+Arena<Particle> allParticles; // room for maxParticle
 
 int currentTotalParticles(0); // current amount of particles in screen
+std::vector<int> walkers; // the particles still moving, in order
+
+// the fixed particles by ring of width collisionDistance and, within a
+// ring, by angle with about one bin per collisionDistance of arc, so a
+// walker is only tested against the few bins it can reach
+struct PolarIndex {
+    struct Entry {
+        float x, y;
+        int index;
+    };
+    std::vector<int> ringStart; // first bin of each ring, then the end
+    std::vector<std::vector<Entry>> bins;
+
+    static int bins_in(int ring) {
+        return std::max(1, (int)(ring*PI3));
+    }
+    int rings() const {
+        return (int)ringStart.size()-1;
+    }
+    int ring(float radius) const {
+        return std::min(rings()-1, std::max(0, (int)(radius/collisionDistance)));
+    }
+    int bin(int ring, float angle) const {
+        int n = bins_in(ring);
+        int b = (int)((angle + PI/6) / PI3 * n);
+        return std::min(n-1, std::max(0, b));
+    }
+
+    void init(float maxRadius) {
+        ringStart.assign(1, 0);
+        for (int k=0; k<(int)(maxRadius/collisionDistance)+2; k++) {
+            ringStart.push_back(ringStart.back() + bins_in(k));
+        }
+        bins.assign(ringStart.back(), std::vector<Entry>());
+    }
+
+    void add(const Particle& p, int index) {
+        int k = ring(p.radius);
+        bins[ringStart[k] + bin(k, p.angle)].push_back(Entry {p.x, p.y, index});
+    }
+
+    // the first fixed particle within collisionDistance of the walker at
+    // (x, y), or -1
+    int find(const Particle& p, float x, float y) const {
+        int found(-1);
+        int k = ring(p.radius);
+        for (int q=std::max(0, k-1); q<=std::min(rings()-1, k+1); q++) {
+            // both are at least rho from the center, so they are at least
+            // 2*rho*sin(da/2) >= 2*rho*da/PI apart
+            float rho = std::min(p.radius, q*collisionDistance);
+            int first(0), last(bins_in(q)-1);
+            if (rho > collisionDistance) {
+                float da = PI*collisionDistance / (2*rho);
+                first = bin(q, p.angle-da);
+                last = bin(q, p.angle+da);
+            }
+            for (int b=first; b<=last; b++) {
+                for (const Entry& e : bins[ringStart[q] + b]) {
+                    STATS_ONLY(stats.tests++;)
+                    // the same float arithmetic as the pair test it replaces
+                    double dx = x - e.x;
+                    double dy = y - e.y;
+                    float dst(std::sqrt(dx*dx + dy*dy));
+                    if (dst < collisionDistance && (found < 0 || e.index < found))
+                        found = e.index;
+                }
+            }
+        }
+        return found;
+    }
+};
 
-bool is_collision(Particle& A, Particle& B) {
-    double AxBx = A.radius * std::cos(A.angle) - B.radius * std::cos(B.angle); // A.x - B.x;
-    double AyBy = A.radius * std::sin(A.angle) - B.radius * std::sin(B.angle); // A.y - B.y;
+PolarIndex fixedIndex;
 
-    if (AxBx > COLLISION_DISTANCE)
-        return false;
-    else if (AyBy > COLLISION_DISTANCE)
-        return false;
+void fix(int i, int bond) {
+    Particle& p = allParticles[i];
+    p.isFixed = true;
+    p.x = p.radius * std::cos(p.angle);
+    p.y = p.radius * std::sin(p.angle);
+    p.bond = bond;
+    fixedIndex.add(p, i);
+}
 
-    float dst(std::sqrt(AxBx*AxBx + AyBy*AyBy));
-    return dst < COLLISION_DISTANCE;
+// --seed N and the settings (--width, --height, --particles, --walkers,
+// --dot-radius, --overlap, --speed, --fps), on the command line or in a
+// --config file. Returns the first argument that is not an option.
+const char* parse_options(int argc, char **argv) {
+    const char* positional = parse_command_line(argc, argv, {},
+        [](const std::string& name, const char* value) {
+            if (name == "seed")
+                seed = std::strtoull(value, nullptr, 10);
+            else if (name == "width")
+                width = std::max(1, std::atoi(value));
+            else if (name == "height")
+                height = std::max(1, std::atoi(value));
+            else if (name == "particles")
+                maxParticle = std::max(2, (int)std::atof(value));
+            else if (name == "walkers")
+                maxSimultaneous = std::max(1, std::atoi(value));
+            else if (name == "dot-radius")
+                dotRadius = std::max(1, std::atoi(value));
+            else if (name == "overlap")
+                overlapTol = std::atof(value);
+            else if (name == "speed")
+                speed = std::atof(value);
+            else if (name == "fps")
+                fps = std::max(1, std::atoi(value));
+            else
+                return false;
+            return true;
+        });
+    collisionDistance = dotRadius*2 - overlapTol;
+    return positional;
 }
 
 void init_particles () {
-    allParticles[0] = Particle {0, 0, true};
-    //allParticles[0] = Particle {WIDTH/2, HEIGHT/2, true};
+    allParticles.reserve(maxParticle);
+    allParticles.clear();
+    currentTotalParticles = 0;
+    walkers.clear();
+    fixedIndex.init(width);
+    allParticles.push_back(Particle {0, 0, false, 0, 0, -1});
+    //allParticles[0] = Particle {width/2, height/2, true};
+    fix(0, -1);
 
     currentTotalParticles++;
-    for (int i=0; i<MAX_SIMULTANEOUS; i++) {
+    for (int i=0; i<maxSimultaneous; i++) {
         add_new_particle();
     }
 }
 
 void add_new_particle() {
-    if (currentTotalParticles >= MAX_PARTICLE)
+    if (currentTotalParticles >= maxParticle)
         return;
     //double angle(rand()%31);
-    Particle P = {WIDTH, 0, false};
-    //Particle P = {WIDTH, HEIGHT/2, false};
-    allParticles[currentTotalParticles] = P;
+    Particle P = {(float)width, 0, false, 0, 0, -1};
+    //Particle P = {width, height/2, false};
+    allParticles.push_back(P);
+    walkers.push_back(currentTotalParticles);
     currentTotalParticles++;
 }
 
 void check_collisions() {
-    // i for the free and j for the fixed
-    for (int i=0; i<currentTotalParticles; i++) {
-        if (allParticles[i].isFixed == true)
-            continue;
-        for (int j=0; j<currentTotalParticles; j++) {
-            if (allParticles[j].isFixed == false)
-                continue;
-            if (is_collision(allParticles[i], allParticles[j])) {
-                allParticles[i].isFixed = true;
-                add_new_particle();
-                break;
-            }
+    // the new walkers are appended and tested in the same pass
+    size_t kept(0);
+    for (size_t w=0; w<walkers.size(); w++) {
+        int i = walkers[w];
+        Particle& p = allParticles[i];
+        int bond = fixedIndex.find(p, p.radius * std::cos(p.angle), p.radius * std::sin(p.angle));
+        if (bond >= 0) {
+            STATS_ONLY(ScopedTimer timer(stats.commitTime);)
+            fix(i, bond);
+            STATS_ONLY(stats.sticks++;)
+            add_new_particle();
+        } else {
+            walkers[kept++] = i;
         }
     }
+    walkers.resize(kept);
 }
 
 void update_particles() {
-    for (int i=0; i<currentTotalParticles; i++) {
-        if (allParticles[i].isFixed)
-            continue;
+    STATS_ONLY(ScopedTimer timer(stats.stepTime);)
+    STATS_ONLY(stats.ticks++;)
+    for (int i : walkers) {
+        STATS_ONLY(stats.steps++;)
         allParticles[i].update();
         allParticles[i].border_control();
     }
 }
 
+// one "x y" line per fixed particle of the simulated wedge
+bool save_cluster(const char* path) {
+    std::ofstream file(path);
+    for (int i=0; i<currentTotalParticles; i++) {
+        Particle& p = allParticles[i];
+        if (!p.isFixed)
+            continue;
+        file << p.x << " " << p.y << "\n";
+    }
+    return (bool)file;
+}
+
+#ifndef HEADLESS
+
 void draw_walls() {
     glLineWidth(1);
     glColor3f(0.6, 0.6, 0.6);
     for (float x=PI/6; x<TWO_PI; x+=PI3) {
         glBegin(GL_LINE_STRIP);
           glVertex2f(0, 0);
-          glVertex2f(WIDTH*std::cos(x), HEIGHT*std::sin(x));
+          glVertex2f(width*std::cos(x), height*std::sin(x));
+        glEnd();
+    }
+}
+
+// the wedge is built once per cluster, balls and bonds, and drawn rotated
+// by 0, 60, ... degrees, flipped every other time
+Disc disc;
+VertexBuffer balls, bonds;
+int drawnParticles(0); // particles already in the buffers
+
+// the walkers are few, they are drawn directly
+void draw_walkers() {
+    for (int i : walkers) {
+        const Particle& p = allParticles[i];
+        float x(p.radius*std::cos(p.angle)), y(p.radius*std::sin(p.angle));
+        glBegin(GL_POLYGON);
+        for (size_t k=0; k<disc.x.size(); k++) {
+            glVertex2f(x + disc.x[k], y + disc.y[k]);
+        }
         glEnd();
     }
 }
 
 void draw_all() {
+    // up to the first walker, it may stick later
+    for (; drawnParticles<currentTotalParticles && allParticles[drawnParticles].isFixed; drawnParticles++) {
+        const Particle& p = allParticles[drawnParticles];
+        balls.add_disc(p.x, p.y, disc);
+        if (p.bond >= 0) {
+            bonds.add(p.x, p.y);
+            bonds.add(allParticles[p.bond].x, allParticles[p.bond].y);
+        }
+    }
+    balls.upload();
+    bonds.upload();
+
     glLineWidth(10.0);
     glColor3f(1.0, 0.0, 0.0);
-    Particle p1, p2;
-    for (int i=0; i<currentTotalParticles; i++) {
-        p1 = allParticles[i];
-        for (int j=0; j<currentTotalParticles; j++) {
-            if (i==j)
-                continue;
-            p2 = allParticles[j];
-            // drawing the ball
-            for (float d=0, e=1; d<TWO_PI; d+=PI3, e*=-1) {
-                glBegin(GL_POLYGON);
-                for (float i=0; i<TWO_PI; i+=PI/10) {
-                    glVertex2f(p1.radius*std::cos(e*p1.angle+d) + (DOT_RADIUS-2)*std::cos(i),
-                               p1.radius*std::sin(e*p1.angle+d) + (DOT_RADIUS-2)*std::sin(i));
-                }
-                glEnd();
-            }
-            // if collision draw a line between
-            if (is_collision(p1, p2)) {
-                for (float d=0, e=1; d<TWO_PI; d+=PI3, e*=-1) {
-                    glBegin(GL_LINE_STRIP);
-                      glVertex2f(p1.radius*std::cos(e*p1.angle+d),
-                                 p1.radius*std::sin(e*p1.angle+d));
-                      glVertex2f(p2.radius*std::cos(e*p2.angle+d),
-                                 p2.radius*std::sin(e*p2.angle+d));
-                    glEnd();
-                }
-                break;
-            }
-        }
+    for (int k=0; k<6; k++) {
+        glPushMatrix();
+        glRotatef(k*60, 0, 0, 1);
+        glScalef(1, k%2 ? -1 : 1, 1);
+        balls.draw(GL_TRIANGLES);
+        bonds.draw(GL_LINES);
+        draw_walkers();
+        glPopMatrix();
     }
 }
 
 void init() {
     glClearColor(0.3, 0.5, 0.3, 1.0);
-    std::srand(std::time(0));
+    disc.init(dotRadius-2, 20);
+    balls.clear();
+    bonds.clear();
+    drawnParticles = 0;
     init_particles();
 }
 
@@ -186,30 +355,28 @@ void display_callback() {
     glutSwapBuffers();
 }
 
-void reshape_callback(int width, int height) {
-    glViewport(0, 0, (GLsizei)width, (GLsizei) height);
+void reshape_callback(int windowWidth, int windowHeight) {
+    glViewport(0, 0, (GLsizei)windowWidth, (GLsizei) windowHeight);
     glMatrixMode(GL_PROJECTION);
     glLoadIdentity();
     int margin(0);
-    glOrtho(-WIDTH/2-margin, WIDTH/2+margin,
-            -HEIGHT/2-margin, HEIGHT/2+margin,
+    glOrtho(-width/2-margin, width/2+margin,
+            -height/2-margin, height/2+margin,
             -1.0, 0.0);
     glMatrixMode(GL_MODELVIEW);
 }
 
 void timer_callback(int) {
     //auto start(std::chrono::steady_clock::now());
-    if (currentTotalParticles>=MAX_PARTICLE) {
-        currentTotalParticles = 0;
-        for (int i=0; i<MAX_PARTICLE; i++) {
-            allParticles[i] = Particle();
-        }
+    if (currentTotalParticles>=maxParticle) {
         init();
     }
-    while(currentTotalParticles < MAX_PARTICLE) {
+    while(currentTotalParticles < maxParticle) {
         check_collisions();
         update_particles();
     }
+    STATS_ONLY(stats.print(std::cerr, "stats");)
+    STATS_ONLY(stats = Stats();)
     glutPostRedisplay(); // run the display_callback function
 
     //auto stop(std::chrono::steady_clock::now());
@@ -220,15 +387,49 @@ void timer_callback(int) {
 
 int main(int argc, char **argv) {
     glutInit(&argc, argv); // initialize
+    parse_options(argc, argv);
+    rng.seed(seed, 0);
+    std::cout << "Seed " << seed << "\n";
     glutInitDisplayMode(GLUT_RGB | GLUT_DOUBLE);
     glutInitWindowPosition(15, 15); // optional
-    glutInitWindowSize(WIDTH, HEIGHT);
+    glutInitWindowSize(width, height);
     glutCreateWindow("Brownian Snowflake");
     glutDisplayFunc(display_callback);
     glutReshapeFunc(reshape_callback);
-    glutTimerFunc(1000/FPS, timer_callback, 0);
+    glutTimerFunc(1000/fps, timer_callback, 0);
     init();
     glutMainLoop();
 
     return 0;
 }
+
+#else
+
+// headless build: g++ -O2 -DHEADLESS Snowflake_1.cpp
+// runs to maxParticle as fast as possible and writes the cluster to disk
+int main(int argc, char **argv) {
+    const char* path = parse_options(argc, argv);
+    if (!path)
+        path = "Snowflake_1.txt";
+    rng.seed(seed, 0);
+    std::cout << "Seed " << seed << "\n";
+    init_particles();
+
+    auto start(std::chrono::steady_clock::now());
+    while (currentTotalParticles < maxParticle) {
+        check_collisions();
+        update_particles();
+    }
+    auto stop(std::chrono::steady_clock::now());
+    auto duration(std::chrono::duration_cast<std::chrono::milliseconds>(stop-start));
+    std::cout << "Finished in " << duration.count() << "ms\n";
+    STATS_ONLY(stats.print(std::cerr, "stats total");)
+
+    if (!save_cluster(path)) {
+        std::cerr << "Cannot write " << path << "\n";
+        return 1;
+    }
+    return 0;
+}
+
+#endif
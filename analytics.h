@@ -0,0 +1,111 @@
+/* Cluster statistics kept up to date as the particles stick */
+
+#ifndef ANALYTICS_H
+#define ANALYTICS_H
+
+#include <cmath>
+#include <vector>
+#include <ostream>
+#include <algorithm>
+
+// least squares slope of y over x, fed one point at a time
+struct SlopeFit {
+    double n = 0, sx = 0, sy = 0, sxx = 0, sxy = 0;
+
+    void add(double x, double y) {
+        n++;
+        sx += x;
+        sy += y;
+        sxx += x*x;
+        sxy += x*y;
+    }
+
+    double slope() const {
+        double d = n*sxx - sx*sx;
+        return (n < 2 || d == 0) ? 0 : (n*sxy - sx*sy) / d;
+    }
+};
+
+// Every stick costs a handful of additions:
+//  - radius of gyration from the running sums of x, y and x^2 + y^2
+//  - the growth front, the largest distance along the growth direction
+//    (radius from the seed, height over the floor, depth into the ring)
+//  - where the particles stick, as a fraction of the front, averaged
+//    since the last sample
+// The dimension estimates are taken when a sample is written:
+//  - mass-radius: slope of ln N over ln Rg across the samples so far
+//  - box counting: slope of ln(occupied boxes) over ln(1/box size) across
+//    the pyramid levels, whose occupied counts it keeps on each add
+struct ClusterAnalytics {
+    long count = 0;
+    double sumX = 0, sumY = 0, sumR2 = 0;
+    double front = 0;
+    // depth of the sticks since the last sample, relative to the front
+    double depthSum = 0, depthSquares = 0;
+    long depthCount = 0;
+    SlopeFit massRadius;
+
+    void reset() {
+        *this = ClusterAnalytics();
+    }
+
+    void add(int x, int y, double distance) {
+        count++;
+        sumX += x;
+        sumY += y;
+        sumR2 += (double)x*x + (double)y*y;
+        if (front > 0) {
+            double depth = distance/front;
+            depthSum += depth;
+            depthSquares += depth*depth;
+            depthCount++;
+        }
+        front = std::max(front, distance);
+    }
+
+    double gyration() const {
+        if (!count)
+            return 0;
+        double cx = sumX/count, cy = sumY/count;
+        return std::sqrt(std::max(0.0, sumR2/count - cx*cx - cy*cy));
+    }
+
+    // occupied[k] boxes of 2^(k+1) sites, fitted over the boxes smaller
+    // than the cluster
+    double box_dimension(const std::vector<long>& occupied) const {
+        SlopeFit fit;
+        fit.add(0, std::log((double)count)); // boxes of one site
+        for (size_t k=0; k<occupied.size(); k++) {
+            double size = 2 << k;
+            if (size*4 > front || occupied[k] < 4)
+                break;
+            fit.add(-std::log(size), std::log((double)occupied[k]));
+        }
+        return fit.slope();
+    }
+
+    static void header(std::ostream& out) {
+        out << "particles,steps,gyration,front,mass_dimension,box_dimension,"
+               "stick_depth,stick_depth_std\n";
+    }
+
+    // one line of the time series, then starts a new window
+    void sample(std::ostream& out, unsigned long long steps, const std::vector<long>& occupied) {
+        double rg = gyration();
+        // tiny clusters are all lattice effects
+        if (count >= 100 && rg > 0)
+            massRadius.add(std::log(rg), std::log((double)count));
+        double mean(0), deviation(0);
+        if (depthCount) {
+            mean = depthSum/depthCount;
+            deviation = std::sqrt(std::max(0.0, depthSquares/depthCount - mean*mean));
+        }
+        out << count << "," << steps << "," << rg << "," << front << ","
+            << massRadius.slope() << "," << box_dimension(occupied) << ","
+            << mean << "," << deviation << "\n";
+        depthSum = depthSquares = 0;
+        depthCount = 0;
+    }
+};
+
+#endif
@@ -0,0 +1,91 @@
+/* Growable array over reserved address space */
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <cstring>
+#include <new>
+#include <algorithm>
+#include <type_traits>
+
+#include <sys/mman.h>
+
+// An append-only array of plain values that never moves.
+// reserve() maps address space for the largest size wanted, the kernel
+// only backs the pages once they are written, so reserving room for a huge
+// cluster costs nothing until it grows. Pointers and the data() handed to
+// fwrite stay valid as it grows.
+// Growing past the reservation remaps it, which may move it: reserve the
+// final size up front.
+template <class T>
+class Arena {
+    static_assert(std::is_trivially_copyable<T>::value, "values are copied as bytes");
+
+public:
+    Arena() {}
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    ~Arena() {
+        if (items)
+            munmap(items, capacity*sizeof(T));
+    }
+
+    void reserve(size_t n) {
+        if (n <= capacity)
+            return;
+        // at least a page, then whole pages
+        size_t page(4096);
+        size_t bytes = (std::max(n*sizeof(T), page) + page - 1) / page * page;
+        void* p;
+        if (items)
+            p = mremap(items, capacity*sizeof(T), bytes, MREMAP_MAYMOVE);
+        else
+            p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (p == MAP_FAILED)
+            throw std::bad_alloc();
+        items = (T*)p;
+        capacity = bytes / sizeof(T);
+    }
+
+    void push_back(const T& value) {
+        if (count == capacity)
+            reserve(std::max<size_t>(2*capacity, 1024));
+        items[count++] = value;
+    }
+
+    // new values are not initialised
+    void resize(size_t n) {
+        reserve(n);
+        count = n;
+    }
+
+    void assign(const T* first, const T* last) {
+        resize(last-first);
+        std::memcpy((void*)items, first, (last-first)*sizeof(T));
+    }
+
+    void clear() {
+        count = 0;
+    }
+
+    size_t size() const { return count; }
+    bool empty() const { return !count; }
+    T* data() { return items; }
+    const T* data() const { return items; }
+    T* begin() { return items; }
+    T* end() { return items+count; }
+    const T* begin() const { return items; }
+    const T* end() const { return items+count; }
+    T& operator[](size_t i) { return items[i]; }
+    const T& operator[](size_t i) const { return items[i]; }
+    T& back() { return items[count-1]; }
+
+private:
+    T* items = nullptr;
+    size_t count = 0, capacity = 0;
+};
+
+#endif
@@ -0,0 +1,206 @@
+/* Binary checkpoints of an aggregation, see dla_core.h */
+
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <type_traits>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "dla_core.h"
+
+// Layout, in the byte order of the machine that wrote it:
+//   CheckpointHeader
+//   the geometry (its radius state: farthest, highest, closest)
+//   fixed particles        fixedCount x (x, y)
+//   walkers                movingX, movingY, xBits, yBits, walkers x 4 bytes each
+//   random streams         walkers x sizeof(Rng)
+// Everything is a plain array so reading is a few memcpy out of the
+// mapping. The occupancy grid, the pyramid and the analytics are not
+// stored, they are rebuilt from the fixed particles.
+struct CheckpointHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t geometrySize;
+    uint32_t rngSize;
+    int32_t phase;
+    uint64_t seed;
+    uint64_t fixedCount;
+    uint64_t walkers;
+    uint64_t walkerSteps, collisionTests;
+    // the settings of the run, a checkpoint only resumes with the same ones
+    // (maxParticle may change to grow the cluster further)
+    int32_t width, height;
+    int32_t maxParticle;
+    int32_t dotRadius;
+    float overlapTol;
+    int32_t circleRadius;
+    // and the same options of the walk, which the cluster depends on
+    int32_t hop, threads, epoch;
+};
+
+const char CHECKPOINT_MAGIC[8] = {'D', 'L', 'A', 'C', 'K', 'P', 'T', 0};
+const uint32_t CHECKPOINT_VERSION = 2;
+
+template <class Array>
+bool write_array(std::FILE* file, const Array& v) {
+    return std::fwrite(v.data(), sizeof(v[0]), v.size(), file) == v.size();
+}
+
+// Writes to path.tmp then renames it over path, so a run killed while
+// writing leaves the previous checkpoint intact.
+template <class A>
+bool save_checkpoint(const A& dla, const char* path) {
+    static_assert(std::is_trivially_copyable<decltype(dla.geometry)>::value,
+                  "the geometry is stored as raw bytes");
+    const Settings& s = dla.settings;
+    CheckpointHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic));
+    header.version = CHECKPOINT_VERSION;
+    header.geometrySize = sizeof(dla.geometry);
+    header.rngSize = sizeof(Rng);
+    header.phase = dla.phase;
+    header.seed = dla.seed;
+    header.fixedCount = dla.fixedParticles.size();
+    header.walkers = dla.movingX.size();
+    header.walkerSteps = dla.walkerSteps;
+    header.collisionTests = dla.collisionTests;
+    header.width = s.width;
+    header.height = s.height;
+    header.maxParticle = s.maxParticle;
+    header.dotRadius = s.dotRadius;
+    header.overlapTol = s.overlapTol;
+    header.circleRadius = s.circleRadius;
+    header.hop = dla.hop;
+    header.threads = dla.threads;
+    header.epoch = dla.epoch;
+
+    std::string tmp = std::string(path) + ".tmp";
+    std::FILE* file = std::fopen(tmp.c_str(), "wb");
+    if (!file)
+        return false;
+    bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1
+           && std::fwrite(&dla.geometry, sizeof(dla.geometry), 1, file) == 1
+           && write_array(file, dla.fixedParticles)
+           && write_array(file, dla.movingX)
+           && write_array(file, dla.movingY)
+           && write_array(file, dla.xBits)
+           && write_array(file, dla.yBits)
+           && write_array(file, dla.rngs);
+    ok = (std::fclose(file) == 0) && ok;
+    if (!ok || std::rename(tmp.c_str(), path) != 0) {
+        std::remove(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+// read cursor over the mapped file
+struct CheckpointReader {
+    const char* data;
+    size_t size, offset;
+
+    template <class T>
+    bool read(T* out, size_t count) {
+        size_t bytes = sizeof(T)*count;
+        if (bytes > size - offset)
+            return false;
+        std::memcpy((void*)out, data+offset, bytes);
+        offset += bytes;
+        return true;
+    }
+    template <class Array>
+    bool read(Array& out, size_t count) {
+        out.resize(count);
+        return read(out.data(), count);
+    }
+};
+
+// Restores a run saved by save_checkpoint. On failure error says why and
+// the aggregation is left as it was.
+template <class A>
+bool load_checkpoint(A& dla, const char* path, std::string& error) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        error = "cannot open";
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size < (off_t)sizeof(CheckpointHeader)) {
+        close(fd);
+        error = "too short";
+        return false;
+    }
+    size_t size = info.st_size;
+    void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) {
+        error = "cannot map";
+        return false;
+    }
+    // the file is read once, front to back
+    madvise(mapped, size, MADV_SEQUENTIAL);
+
+    CheckpointReader in {(const char*)mapped, size, 0};
+    CheckpointHeader header;
+    in.read(&header, 1);
+    const Settings& s = dla.settings;
+    bool ok(false);
+    if (std::memcmp(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic))
+        || header.version != CHECKPOINT_VERSION)
+        error = "not a checkpoint";
+    else if (header.geometrySize != sizeof(dla.geometry) || header.rngSize != sizeof(Rng))
+        error = "written by another program or random generator";
+    else if (size != sizeof(header) + header.geometrySize
+                     + header.fixedCount*sizeof(Particle)
+                     + header.walkers*(4*sizeof(int) + header.rngSize))
+        error = "truncated";
+    else if (header.width != s.width || header.height != s.height
+             || header.walkers != (uint64_t)s.maxSimultaneous
+             || header.dotRadius != s.dotRadius || header.overlapTol != s.overlapTol
+             || header.circleRadius != s.circleRadius)
+        error = "written with other settings";
+    else if (header.hop != dla.hop || header.threads != dla.threads || header.epoch != dla.epoch)
+        error = "written with other --hop, --threads or --epoch";
+    else
+        ok = true;
+    if (!ok) {
+        munmap(mapped, size);
+        return false;
+    }
+
+    // size the lattice and place the seeds, then put the saved state over it
+    dla.seed = header.seed;
+    dla.init_particles();
+    decltype(dla.geometry) geometry;
+    size_t n = header.walkers;
+    in.read(&geometry, 1);
+    in.read(dla.fixedParticles, header.fixedCount);
+    in.read(dla.movingX, n);
+    in.read(dla.movingY, n);
+    in.read(dla.xBits, n);
+    in.read(dla.yBits, n);
+    in.read(dla.rngs, n);
+    munmap(mapped, size);
+    dla.geometry = geometry;
+    dla.phase = header.phase;
+    dla.walkerSteps = header.walkerSteps;
+    dla.collisionTests = header.collisionTests;
+    // the seeds placed by init_particles are in the list again
+    dla.analytics.reset();
+    for (const Particle& p : dla.fixedParticles) {
+        dla.index(p);
+    }
+    return true;
+}
+
+#endif
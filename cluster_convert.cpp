@@ -0,0 +1,106 @@
+
+/* Converts a cluster stream (see cluster_stream.h) to CSV or PLY */
+
+// g++ -O2 cluster_convert.cpp -o cluster_convert
+// cluster_convert cluster.bin cluster.csv
+// cluster_convert cluster.bin cluster.ply
+
+#include <iostream>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "cluster_stream.h"
+
+bool ends_with(const char* s, const char* suffix) {
+    size_t n(std::strlen(s)), m(std::strlen(suffix));
+    return n >= m && !std::strcmp(s+n-m, suffix);
+}
+
+// csv: one "order,x,y,cluster" line per particle
+void write_csv(std::FILE* out, const int32_t* records, size_t count) {
+    std::fprintf(out, "order,x,y,cluster\n");
+    int order(0), cluster(0);
+    for (size_t i=0; i<count; i++) {
+        int x(records[2*i]), y(records[2*i+1]);
+        if (x == STREAM_END_OF_CLUSTER && y == STREAM_END_OF_CLUSTER) {
+            order = 0;
+            cluster++;
+            continue;
+        }
+        std::fprintf(out, "%d,%d,%d,%d\n", order++, x, y, cluster);
+    }
+}
+
+// ascii ply point cloud, z = 0, with the sticking order as a property
+void write_ply(std::FILE* out, const int32_t* records, size_t count) {
+    size_t vertices(0);
+    for (size_t i=0; i<count; i++) {
+        if (records[2*i] != STREAM_END_OF_CLUSTER || records[2*i+1] != STREAM_END_OF_CLUSTER)
+            vertices++;
+    }
+    std::fprintf(out, "ply\nformat ascii 1.0\ncomment diffusion limited aggregation\n");
+    std::fprintf(out, "element vertex %zu\n", vertices);
+    std::fprintf(out, "property float x\nproperty float y\nproperty float z\n");
+    std::fprintf(out, "property int order\nproperty int cluster\nend_header\n");
+    int order(0), cluster(0);
+    for (size_t i=0; i<count; i++) {
+        int x(records[2*i]), y(records[2*i+1]);
+        if (x == STREAM_END_OF_CLUSTER && y == STREAM_END_OF_CLUSTER) {
+            order = 0;
+            cluster++;
+            continue;
+        }
+        std::fprintf(out, "%d %d 0 %d %d\n", x, y, order++, cluster);
+    }
+}
+
+int main(int argc, char **argv) {
+    if (argc != 3 || !(ends_with(argv[2], ".csv") || ends_with(argv[2], ".ply"))) {
+        std::cerr << "usage: " << argv[0] << " STREAM OUTPUT.csv|OUTPUT.ply\n";
+        return 2;
+    }
+    int fd = open(argv[1], O_RDONLY);
+    struct stat info;
+    if (fd < 0 || fstat(fd, &info) != 0 || info.st_size < (off_t)sizeof(StreamHeader)) {
+        std::cerr << "Cannot read " << argv[1] << "\n";
+        return 1;
+    }
+    size_t size = info.st_size;
+    void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) {
+        std::cerr << "Cannot map " << argv[1] << "\n";
+        return 1;
+    }
+    const StreamHeader* header = (const StreamHeader*)mapped;
+    if (std::memcmp(header->magic, STREAM_MAGIC, sizeof(header->magic))
+        || header->version != STREAM_VERSION || header->recordSize != 2*sizeof(int32_t)) {
+        std::cerr << argv[1] << " is not a cluster stream\n";
+        return 1;
+    }
+    // a stream still being written may end in the middle of a record
+    const int32_t* records = (const int32_t*)(header+1);
+    size_t count = (size - sizeof(StreamHeader)) / header->recordSize;
+
+    std::FILE* out = std::fopen(argv[2], "w");
+    if (!out) {
+        std::cerr << "Cannot write " << argv[2] << "\n";
+        return 1;
+    }
+    if (ends_with(argv[2], ".csv"))
+        write_csv(out, records, count);
+    else
+        write_ply(out, records, count);
+    munmap(mapped, size);
+    if (std::fclose(out) != 0) {
+        std::cerr << "Cannot write " << argv[2] << "\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,94 @@
+/* Binary stream of the fixed particles in the order they stuck */
+
+#ifndef CLUSTER_STREAM_H
+#define CLUSTER_STREAM_H
+
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <climits>
+
+// Layout:
+//   StreamHeader
+//   one (int32 x, int32 y) record per fixed particle, in sticking order
+// A record of (INT_MIN, INT_MIN) closes a cluster when the program starts
+// a new one (snowflake_2 starts over at maxParticle).
+// cluster_convert.cpp turns a stream into CSV or PLY.
+struct StreamHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t recordSize;
+};
+
+const char STREAM_MAGIC[8] = {'D', 'L', 'A', 'S', 'T', 'R', 'M', 0};
+const uint32_t STREAM_VERSION = 1;
+const int STREAM_END_OF_CLUSTER = INT_MIN;
+
+// The fixed particles only ever get appended, so the stream keeps how many
+// it has written and hands the new tail of the array to fwrite as it is.
+// Records go through a stdio buffer and are flushed once per tick.
+class ClusterStream {
+public:
+    ClusterStream() {}
+    ClusterStream(const ClusterStream&) = delete;
+    ClusterStream& operator=(const ClusterStream&) = delete;
+
+    ~ClusterStream() {
+        close();
+    }
+
+    bool open(const char* path) {
+        close();
+        file = std::fopen(path, "wb");
+        if (!file)
+            return false;
+        std::setvbuf(file, nullptr, _IOFBF, 1 << 20);
+        StreamHeader header;
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, STREAM_MAGIC, sizeof(header.magic));
+        header.version = STREAM_VERSION;
+        header.recordSize = 2*sizeof(int32_t);
+        written = 0;
+        return std::fwrite(&header, sizeof(header), 1, file) == 1;
+    }
+
+    bool is_open() const {
+        return file != nullptr;
+    }
+
+    // writes fixed[written..count)
+    template <class P>
+    void append(const P* fixed, size_t count) {
+        static_assert(sizeof(P) == 2*sizeof(int32_t), "a particle is one record");
+        if (!file || count <= written)
+            return;
+        std::fwrite(fixed+written, sizeof(P), count-written, file);
+        written = count;
+    }
+
+    // the cluster is starting over
+    void restart() {
+        if (!file || !written)
+            return;
+        const int32_t mark[2] = {STREAM_END_OF_CLUSTER, STREAM_END_OF_CLUSTER};
+        std::fwrite(mark, sizeof(mark), 1, file);
+        written = 0;
+    }
+
+    void flush() {
+        if (file)
+            std::fflush(file);
+    }
+
+    void close() {
+        if (file)
+            std::fclose(file);
+        file = nullptr;
+    }
+
+private:
+    std::FILE* file = nullptr;
+    size_t written = 0;
+};
+
+#endif
@@ -0,0 +1,78 @@
+/* Command line and config file options */
+
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <functional>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+// Options are "--name value", or "--name" alone for the flags.
+// A config file holds the same options as "name value" or "name = value"
+// lines, a flag alone on its line, # starts a comment. "--config FILE"
+// reads one where it stands, so later options override it.
+// The handler returns false for a name it does not know.
+typedef std::function<bool(const std::string& name, const char* value)> OptionHandler;
+
+inline bool read_config(const char* path, const OptionHandler& set) {
+    std::ifstream file(path);
+    if (!file) {
+        std::cerr << "Cannot read " << path << "\n";
+        return false;
+    }
+    std::string line;
+    int number(0);
+    while (std::getline(file, line)) {
+        number++;
+        line = line.substr(0, line.find('#'));
+        std::replace(line.begin(), line.end(), '=', ' ');
+        std::istringstream words(line);
+        std::string name, value;
+        if (!(words >> name))
+            continue;
+        words >> value;
+        if (!set(name, value.empty() ? nullptr : value.c_str())) {
+            std::cerr << path << ":" << number << ": unknown option " << name << "\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+// Feeds every option to set and returns the first argument that is not an
+// option, or nullptr. Exits on an unknown option or a config file that
+// cannot be read: a parameter sweep should not run with the wrong values.
+inline const char* parse_command_line(int argc, char **argv,
+                                      const std::vector<std::string>& flags,
+                                      const OptionHandler& set) {
+    const char* positional(nullptr);
+    for (int i=1; i<argc; i++) {
+        if (std::strncmp(argv[i], "--", 2)) {
+            if (!positional)
+                positional = argv[i];
+            continue;
+        }
+        std::string name(argv[i]+2);
+        bool flag = std::find(flags.begin(), flags.end(), name) != flags.end();
+        if (!flag && i+1 >= argc) {
+            std::cerr << "Missing value after " << argv[i] << "\n";
+            std::exit(2);
+        }
+        const char* value = flag ? nullptr : argv[++i];
+        bool ok = name == "config" ? read_config(value, set) : set(name, value);
+        if (!ok) {
+            if (name != "config")
+                std::cerr << "Unknown option " << argv[i - (flag ? 0 : 1)] << "\n";
+            std::exit(2);
+        }
+    }
+    return positional;
+}
+
+#endif
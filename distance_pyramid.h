@@ -0,0 +1,75 @@
+/* Coarse occupancy levels giving a lower bound on the distance to the cluster */
+
+#ifndef DISTANCE_PYRAMID_H
+#define DISTANCE_PYRAMID_H
+
+#include <vector>
+#include <memory>
+
+#include "sparse_lattice.h"
+
+// Level k (k >= 1) cuts the lattice in blocks of 2^k x 2^k sites and marks
+// the blocks holding at least one fixed particle.
+// If the block of a point and its 8 neighbours are empty at level k, every
+// fixed particle is at least 2^k away from the point. Emptiness only gets
+// rarer going up, so the bound is found by climbing from the first useful
+// level until a marked block shows up.
+// Each level is a SparseLattice of blocks, so like the occupancy grid it
+// has no bounds; LEVELS covers any cluster that fits in memory.
+struct DistancePyramid {
+    static const int LEVELS = 24;
+    int minX, minY;
+    int levels;
+    std::vector<std::unique_ptr<SparseLattice>> blocks; // blocks[0] is level 1
+    std::vector<long> occupied; // marked blocks per level, for box counting
+
+    // the directories start over [xMin, xMax] x [yMin, yMax]
+    void init(int xMin, int yMin, int xMax, int yMax) {
+        minX = xMin;
+        minY = yMin;
+        levels = LEVELS;
+        blocks.resize(levels);
+        occupied.assign(levels, 0);
+        for (int k=0; k<levels; k++) {
+            if (!blocks[k])
+                blocks[k].reset(new SparseLattice());
+            blocks[k]->init(0, 0, (xMax-xMin) >> (k+1), (yMax-yMin) >> (k+1));
+        }
+    }
+
+    void add(int x, int y) {
+        int X(x-minX), Y(y-minY);
+        for (int k=0; k<levels; k++) {
+            unsigned char& block = blocks[k]->at(X >> (k+1), Y >> (k+1));
+            occupied[k] += !block;
+            block = 1;
+        }
+    }
+
+    bool empty_around(int k, int bx, int by) const {
+        const SparseLattice& level = *blocks[k];
+        for (int j=by-1; j<=by+1; j++) {
+            for (int i=bx-1; i<=bx+1; i++) {
+                if (level.get(i, j))
+                    return false;
+            }
+        }
+        return true;
+    }
+
+    // every fixed particle is at least this far from (x, y), the search
+    // starts at blocks of 2^firstLevel sites and 0 means "closer than that"
+    float distance_bound(int x, int y, int firstLevel = 1) const {
+        // arithmetic shift keeps the blocks aligned on both sides of minX
+        int X(x-minX), Y(y-minY);
+        float bound(0);
+        for (int k=firstLevel-1; k<levels; k++) {
+            if (!empty_around(k, X >> (k+1), Y >> (k+1)))
+                break;
+            bound = 2 << k;
+        }
+        return bound;
+    }
+};
+
+#endif
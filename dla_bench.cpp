@@ -0,0 +1,269 @@
+
+/* Benchmark of the lattice variants */
+
+// g++ -O2 -pthread dla_bench.cpp -o dla_bench
+// dla_bench [--max N] [--only NAME] [--seed N] [--threads N] [--epoch N] [OUTPUT.json]
+// (or the same options in a --config file)
+//
+// Grows each variant headless from a fixed seed and takes a point of the
+// growth curve at 1, 2 and 5 x 10^k particles. Each point covers the
+// particles stuck since the previous one:
+//   sticks_per_s   particles stuck per second
+//   steps_per_s    walker moves per second
+//   ns_per_test    the cost of one collision test on the cluster as it is
+//                  at that point, timed on its own
+// The lattice of each variant is sized for its largest cluster, the plain
+// circle walk crosses the whole disc for every particle so it stops at 1e5
+// unless --max says otherwise.
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <cstdlib>
+#include <vector>
+#include <string>
+
+#include "dla_core.h"
+#include "dla_geometry.h"
+
+struct Options {
+    uint64_t seed = 1;
+    int threads = 1;
+    int epoch = 1;
+    int maxParticle = 0; // 0: the default of each variant
+    const char* only = nullptr;
+    const char* output = nullptr;
+};
+
+struct Point {
+    int particles;
+    double seconds; // since the start of the run
+    double sticksPerSecond, stepsPerSecond, nsPerTest;
+};
+
+// The grid lookups of the walkers, without their stepping: every walker
+// walks on from where it stands, the sites it visits are collected first
+// and then only the lookups are timed. A walk of its own per walker keeps
+// the scattered accesses of the real ones.
+template <class A>
+double time_lookups(const A& dla, Rng& rng) {
+    const int LOOKUPS = 1 << 20;
+    const int STEPS = 256; // per walk
+    std::vector<int> sites;
+    sites.reserve(2*LOOKUPS);
+    for (int i=0; (int)sites.size() < 2*LOOKUPS; i=(i+1)%dla.settings.maxSimultaneous) {
+        Particle p = dla.walker(i);
+        for (int k=0; k<STEPS && (int)sites.size() < 2*LOOKUPS; k++) {
+            p.x += rng.bit() ? 1 : -1;
+            p.y += rng.bit() ? 1 : -1;
+            sites.push_back(p.x);
+            sites.push_back(p.y);
+        }
+    }
+    auto start(std::chrono::steady_clock::now());
+    int touched(0);
+    for (int i=0; i<LOOKUPS; i++) {
+        touched += dla.grid.touches(sites[2*i], sites[2*i+1]);
+    }
+    auto stop(std::chrono::steady_clock::now());
+    // so the lookups are not optimised away
+    volatile int sink = touched;
+    (void)sink;
+    return std::chrono::duration<double>(stop-start).count()*1e9/LOOKUPS;
+}
+
+// 1000, 2000, 5000, 10000, ... up to maxParticle
+std::vector<int> sample_sizes(int maxParticle) {
+    std::vector<int> sizes;
+    for (long decade=1000; decade<=maxParticle; decade*=10) {
+        for (int m : {1, 2, 5}) {
+            if (decade*m <= maxParticle)
+                sizes.push_back(decade*m);
+        }
+    }
+    if (sizes.empty() || sizes.back() != maxParticle)
+        sizes.push_back(maxParticle);
+    return sizes;
+}
+
+template <class Geometry>
+std::vector<Point> grow(const Settings& settings, bool hop, int iterations,
+                        const Options& options, std::string& kernels) {
+    Aggregation<Geometry> dla(settings);
+    dla.seed = options.seed;
+    dla.threads = options.threads;
+    dla.epoch = options.epoch;
+    dla.hop = hop;
+    dla.init_particles();
+    kernels = walker_kernels().name;
+
+    std::vector<int> sizes = sample_sizes(settings.maxParticle);
+    std::vector<Point> points;
+    size_t next(0);
+    auto start(std::chrono::steady_clock::now());
+    auto last(start);
+    int lastFixed(dla.total_fixed());
+    uint64_t lastSteps(0);
+    Rng rng;
+    rng.seed(options.seed, 0);
+    auto sample = [&] {
+        auto now(std::chrono::steady_clock::now());
+        double interval = std::chrono::duration<double>(now-last).count();
+        double sticks = dla.total_fixed() - lastFixed;
+        double steps = dla.walkerSteps - lastSteps;
+        points.push_back(Point {dla.total_fixed(),
+                                std::chrono::duration<double>(now-start).count(),
+                                sticks/interval, steps/interval, time_lookups(dla, rng)});
+        std::cerr << "  " << dla.total_fixed() << " particles, "
+                  << (int)(sticks/interval) << " sticks/s\n";
+        lastFixed = dla.total_fixed();
+        lastSteps = dla.walkerSteps;
+        while (next < sizes.size() && sizes[next] <= dla.total_fixed())
+            next++;
+        // the time of the lookups is left out of the run
+        auto resumed(std::chrono::steady_clock::now());
+        start += resumed - now;
+        last = resumed;
+    };
+    // the ticks of the program, taken an epoch at a time so that each size
+    // is sampled as soon as it is reached and not at the end of the tick
+    while (!dla.finished()) {
+        for (int i=0; i<iterations && !dla.finished(); i+=dla.epoch) {
+            dla.advance(std::min(dla.epoch, iterations-i));
+            if (next < sizes.size() && dla.total_fixed() >= sizes[next])
+                sample();
+        }
+        dla.run(0);
+    }
+    return points;
+}
+
+// lattice sizes from the fractal dimension (about 1.7) and the densities
+// seen in the demo runs
+Settings center_settings(int n, int walkers) {
+    int radius = 1.5*std::pow(n, 1/1.7) + 50;
+    return Settings {2*radius, 2*radius, n, walkers, 1, 0, 0, 0};
+}
+
+Settings substrate_settings(int n) {
+    int width = 2*std::sqrt(n) + 200;
+    int height = n/(0.15*width) + 100;
+    return Settings {width, height, n, 50, 1, 0, 0, 0};
+}
+
+Settings ring_settings(int n) {
+    int radius = std::sqrt(n/(0.15*3.1415926)) + 50;
+    return Settings {2*radius, 2*radius, n, 50, 1, 0, radius, 0};
+}
+
+struct Case {
+    const char* name;
+    int defaultMax;
+};
+
+// the walker counts and tick lengths are the ones of the programs
+const Case CASES[] = {
+    {"center", 1000000},     // DiffusionLimitedAggregation.cpp
+    {"center-hop", 1000000}, // DiffusionLimitedAggregation.cpp --hop
+    {"bottom", 1000000},     // DLA_bottom.cpp
+    {"circle", 100000},      // DLA_circle.cpp
+    {"circle-hop", 1000000}, // DLA_circle.cpp --hop
+    {"wedge", 1000000},      // snowflake_2.cpp
+};
+
+std::vector<Point> run_case(const std::string& name, int n, const Options& options,
+                            Settings& settings, std::string& kernels) {
+    if (name == "center" || name == "center-hop") {
+        settings = center_settings(n, 100);
+        return grow<CenterSeed>(settings, name == "center-hop", 10000, options, kernels);
+    }
+    if (name == "bottom") {
+        settings = substrate_settings(n);
+        return grow<Substrate>(settings, false, 10000, options, kernels);
+    }
+    if (name == "circle" || name == "circle-hop") {
+        settings = ring_settings(n);
+        return grow<Ring>(settings, name == "circle-hop", 10000, options, kernels);
+    }
+    settings = center_settings(n, 1);
+    return grow<Wedge>(settings, false, 1000, options, kernels);
+}
+
+int main(int argc, char **argv) {
+    Options options;
+    std::string only;
+    options.output = parse_command_line(argc, argv, {},
+        [&](const std::string& name, const char* value) {
+            if (!value)
+                return false;
+            if (name == "seed")
+                options.seed = std::strtoull(value, nullptr, 10);
+            else if (name == "threads")
+                options.threads = std::max(1, std::atoi(value));
+            else if (name == "epoch")
+                options.epoch = std::max(1, std::atoi(value));
+            else if (name == "max")
+                options.maxParticle = std::max(1000, (int)std::atof(value));
+            else if (name == "only")
+                only = value;
+            else
+                return false;
+            return true;
+        });
+    if (!only.empty()) {
+        bool known(false);
+        for (const Case& c : CASES) {
+            known = known || only == c.name;
+        }
+        if (!known) {
+            std::cerr << "Unknown variant " << only << ", one of center, center-hop, bottom, circle, circle-hop, wedge\n";
+            return 2;
+        }
+        options.only = only.c_str();
+    }
+
+    std::ostringstream json;
+    json << "{\n  \"seed\": " << options.seed << ",\n  \"threads\": " << options.threads
+         << ",\n  \"epoch\": " << options.epoch << ",\n  \"runs\": [";
+    bool first(true);
+    for (const Case& c : CASES) {
+        if (options.only && std::strcmp(options.only, c.name))
+            continue;
+        int n = options.maxParticle ? options.maxParticle : c.defaultMax;
+        std::cerr << c.name << " to " << n << " particles\n";
+        Settings s;
+        std::string kernels;
+        std::vector<Point> points = run_case(c.name, n, options, s, kernels);
+
+        json << (first ? "" : ",") << "\n    {\"variant\": \"" << c.name
+             << "\", \"kernels\": \"" << kernels
+             << "\", \"walkers\": " << s.maxSimultaneous
+             << ", \"lattice\": [" << s.width << ", " << s.height << "], \"points\": [";
+        for (size_t i=0; i<points.size(); i++) {
+            const Point& p = points[i];
+            json << (i ? "," : "") << "\n      {\"particles\": " << p.particles
+                 << ", \"seconds\": " << p.seconds
+                 << ", \"sticks_per_s\": " << p.sticksPerSecond
+                 << ", \"steps_per_s\": " << p.stepsPerSecond
+                 << ", \"ns_per_test\": " << p.nsPerTest << "}";
+        }
+        json << "\n    ]}";
+        first = false;
+    }
+    json << "\n  ]\n}\n";
+
+    if (!options.output) {
+        std::cout << json.str();
+        return 0;
+    }
+    std::ofstream file(options.output);
+    file << json.str();
+    if (!file) {
+        std::cerr << "Cannot write " << options.output << "\n";
+        return 1;
+    }
+    return 0;
+}
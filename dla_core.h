@@ -0,0 +1,652 @@
+/* Diffusion Limited Aggregation engine shared by the lattice variants */
+
+#ifndef DLA_CORE_H
+#define DLA_CORE_H
+
+#include <iostream>
+#include <fstream>
+#include <chrono>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+
+#include "occupancy_grid.h"
+#include "distance_pyramid.h"
+#include "thread_pool.h"
+#include "rng.h"
+#include "walker_kernels.h"
+#include "cluster_stream.h"
+#include "stats.h"
+#include "config.h"
+#include "arena.h"
+#include "analytics.h"
+#include "frame_export.h"
+
+struct Particle {
+    int x, y;
+};
+
+// shorter jumps of the accelerated walk are not worth the sqrt and the
+// trigonometry
+const float HOP_MIN = 4;
+
+// below this many walkers (per thread) the vector kernels are not used
+const int FEW_WALKERS = 8;
+
+// defaults from the #defines of each program, the options override them
+struct Settings {
+    int width, height;
+    int maxParticle;
+    int maxSimultaneous;
+    int dotRadius;
+    float overlapTol;
+    int circleRadius; // only used by the circle geometry
+    int fps;          // only used by the GL programs
+};
+
+// clamp box of the walkers
+struct Box {
+    int xMin, yMin, xMax, yMax;
+};
+
+// The geometry decides everything that differs between the variants:
+//   void init(A&)                        size the lattice, place the seeds
+//   Particle spawn(A&, Rng&)             where a new walker starts
+//   void draw_steps(A&, Rng&, uint32_t& xBits, uint32_t& yBits)
+//                                        the next 32 steps of a walker
+//   bool border(A&, Box&)                clamp box, false if there is none
+//   bool jump(A&, Particle&, Rng&)       accelerated move with --hop
+//   bool after_step(A&, Particle&, Rng&) border control the box cannot do,
+//                                        true if the walker was respawned
+//   Band band(A&)                        where a walker can touch anything
+//   bool touch_limit(A&, Particle&)      sticks to a wall instead of the cluster
+//   void on_stick(A&, Particle&)         update the radius state (farthest, ...)
+//   float growth_distance(A&, Particle&) how far along the growth direction
+//                                        a particle is, for the analytics
+//   Box view(A&)                         the window of the GL program
+//   int copies(A&)                       1, or 6 for a snowflake grown in a
+//                                        wedge and drawn by symmetry
+// It is a template parameter so the whole step loop is inlined per variant.
+// Only on_stick changes the geometry, the rest may run on several threads.
+//
+// The walkers are kept as separate x and y arrays and every step goes
+// through the vector kernels of walker_kernels.h: band filter, collision
+// test on the walkers in the band, jumps, step, clamp.
+//
+// The walkers move in epochs of `epoch` steps. During an epoch the cluster is
+// frozen: each walker steps until it touches it, then waits. At the end of
+// the epoch the hits are committed in (step, walker) order, so a given seed
+// grows the same cluster whatever the number of threads.
+template <class Geometry>
+struct Aggregation {
+    Settings settings;
+    Geometry geometry;
+    OccupancyGrid grid;
+    DistancePyramid pyramid;
+    Arena<Particle> fixedParticles; // room for maxParticle, never moves
+    // walkers
+    std::vector<int> movingX, movingY;
+    std::vector<uint32_t> xBits, yBits; // their next steps
+    std::vector<int> active;            // -1 until they touch the cluster
+    // every walker draws from its own stream so the result does not depend
+    // on which thread moved it
+    std::vector<Rng> rngs;
+    int phase = 0; // steps taken modulo 32, the bits are drawn at 0
+
+    uint64_t seed = std::time(0);
+    int threads = 1;
+    int epoch = 1;
+    bool hop = false; // accelerated walk, for the geometries that have one
+    int hopLevel = 1;
+
+    // see checkpoint.h
+    std::string checkpointPath;
+    int checkpointEvery = 10000; // stuck particles between two checkpoints
+    std::string resumePath;
+    int lastCheckpoint = 0;
+
+    // totals since init_particles, for dla_bench.cpp
+    uint64_t walkerSteps = 0;    // moves of walkers still free, jumps included
+    uint64_t collisionTests = 0; // lookups in the occupancy grid
+
+    // with -DDLA_STATS: printed every statsEvery ticks (--stats N) and when
+    // the aggregation goes away
+    int statsEvery = 0;
+    Stats stats, totalStats;
+
+    // --analytics PATH: a line of ClusterAnalytics every analyticsEvery
+    // stuck particles
+    ClusterAnalytics analytics;
+    std::string analyticsPath;
+    int analyticsEvery = 1000;
+    std::ofstream analyticsFile;
+
+    // --frames PATH: an image of the cluster every framesEvery stuck
+    // particles, encoded on a thread of its own
+    std::string framesPath;
+    int framesEvery = 1000;
+    FrameExporter frames;
+
+    // --stream: every stuck particle is appended to it as it is committed
+    std::string streamPath;
+    ClusterStream stream;
+
+    struct Hit {
+        int step, walker;
+        bool operator<(const Hit& other) const {
+            return step < other.step || (step == other.step && walker < other.walker);
+        }
+    };
+    // what each thread needs for its slice of walkers
+    struct Scratch {
+        std::vector<Hit> hits;
+        std::vector<int> near, mask;
+        uint64_t steps, tests;
+        StepCounters counters;
+    };
+    std::unique_ptr<ThreadPool> pool;
+    std::vector<Scratch> scratch;
+
+    Aggregation(const Settings& s) : settings(s) {}
+
+    ~Aggregation() {
+        STATS_ONLY(print_stats(true);)
+    }
+
+    float collision_distance() const {
+        return settings.dotRadius*2 - settings.overlapTol;
+    }
+
+    int total_fixed() const {
+        return (int)fixedParticles.size();
+    }
+
+    bool finished() const {
+        return total_fixed() >= settings.maxParticle;
+    }
+
+    Particle walker(int i) const {
+        return Particle {movingX[i], movingY[i]};
+    }
+
+    void init_particles() {
+        int n = settings.maxSimultaneous;
+        fixedParticles.clear();
+        fixedParticles.reserve(settings.maxParticle);
+        movingX.assign(n, 0);
+        movingY.assign(n, 0);
+        xBits.assign(n, 0);
+        yBits.assign(n, 0);
+        active.assign(n, -1);
+        rngs.resize(n);
+        for (int i=0; i<n; i++) {
+            rngs[i].seed(seed, i);
+        }
+        phase = 0;
+        walkerSteps = 0;
+        collisionTests = 0;
+        lastCheckpoint = 0;
+        stream.restart();
+        analytics.reset();
+        frames.clear();
+        if (threads > 1 && (!pool || pool->size() != threads))
+            pool.reset(new ThreadPool(threads));
+        scratch.assign(threads, Scratch());
+        geometry = Geometry();
+        geometry.init(*this);
+        for (int i=0; i<n; i++) {
+            add_new_particle(i);
+        }
+    }
+
+    // a fresh run, or the one saved in resumePath
+    // with --stream the particles it starts with are written first
+    bool start() {
+        if (!streamPath.empty() && !stream.open(streamPath.c_str())) {
+            std::cerr << "Cannot write " << streamPath << "\n";
+            return false;
+        }
+        if (!analyticsPath.empty()) {
+            analyticsFile.open(analyticsPath);
+            if (!analyticsFile) {
+                std::cerr << "Cannot write " << analyticsPath << "\n";
+                return false;
+            }
+            ClusterAnalytics::header(analyticsFile);
+        }
+        if (!framesPath.empty()) {
+            Box view = geometry.view(*this);
+            if (!frames.open(framesPath, view.xMin, view.yMin, view.xMax, view.yMax,
+                             geometry.copies(*this), settings.dotRadius-1, settings.maxParticle)) {
+                std::cerr << "Cannot write " << framesPath << "\n";
+                return false;
+            }
+        }
+        if (resumePath.empty()) {
+            init_particles();
+        }
+        else {
+            std::string error;
+            if (!load_checkpoint(*this, resumePath.c_str(), error)) {
+                std::cerr << "Cannot resume from " << resumePath << ": " << error << "\n";
+                finish();
+                return false;
+            }
+            lastCheckpoint = total_fixed();
+            // only the seeds were painted
+            frames.clear();
+            for (size_t i=0; i<fixedParticles.size() && frames.is_open(); i++) {
+                frames.paint(fixedParticles[i].x, fixedParticles[i].y, i);
+            }
+        }
+        stream.append(fixedParticles.data(), fixedParticles.size());
+        return true;
+    }
+
+    // once finished: writes the frames still queued, so a write error is
+    // reported before the run is
+    void finish() {
+        frames.close();
+    }
+
+    // saves the run every checkpointEvery stuck particles and when it is over
+    void checkpoint() {
+        if (checkpointPath.empty() || total_fixed() == lastCheckpoint)
+            return;
+        if (total_fixed() - lastCheckpoint < checkpointEvery && !finished())
+            return;
+        if (!save_checkpoint(*this, checkpointPath.c_str()))
+            std::cerr << "Cannot write " << checkpointPath << "\n";
+        lastCheckpoint = total_fixed();
+    }
+
+    // called by the geometry before placing any seed
+    void init_lattice(int xMin, int yMin, int xMax, int yMax) {
+        grid.init(xMin, yMin, xMax, yMax, collision_distance());
+        pyramid.init(xMin, yMin, xMax, yMax);
+        // first pyramid level whose blocks allow a jump of HOP_MIN
+        hopLevel = 1;
+        while ((2 << (hopLevel-1)) < HOP_MIN + collision_distance() + 1)
+            hopLevel++;
+    }
+
+    // every fixed particle is at least this far from p (0 if it is too
+    // close for a jump)
+    float distance_bound(const Particle& p) const {
+        return pyramid.distance_bound(p.x, p.y, hopLevel);
+    }
+
+    // accelerated walk: when nothing is closer than `bound`, the walker jumps
+    // to a random point of the circle that cannot reach the cluster, which is
+    // where a walk from its center would first leave it. One more unit is
+    // kept for rounding back to the lattice.
+    bool jump(Particle& p, float bound, Rng& rng) const {
+        float length = bound - collision_distance() - 1;
+        if (length < HOP_MIN)
+            return false;
+        float angle = rng.uniform() * 6.2831853;
+        p.x += (int)std::lround(length*std::cos(angle));
+        p.y += (int)std::lround(length*std::sin(angle));
+        return true;
+    }
+
+    // everything kept about the fixed particles but the list itself
+    void index(const Particle& p) {
+        grid.add(p.x, p.y);
+        pyramid.add(p.x, p.y);
+        analytics.add(p.x, p.y, geometry.growth_distance(*this, p));
+    }
+
+    void fix(const Particle& p) {
+        fixedParticles.push_back(p);
+        index(p);
+        geometry.on_stick(*this, p);
+        if (analyticsFile.is_open() && analytics.count % analyticsEvery == 0)
+            analytics.sample(analyticsFile, walkerSteps, pyramid.occupied);
+        if (frames.is_open()) {
+            frames.paint(p.x, p.y, total_fixed()-1);
+            if (total_fixed() % framesEvery == 0)
+                frames.submit();
+        }
+    }
+
+    void add_new_particle(int n) {
+        if (finished())
+            return;
+        Particle p = geometry.spawn(*this, rngs[n]);
+        movingX[n] = p.x;
+        movingY[n] = p.y;
+    }
+
+    // two bits per step and walker, so one draw lasts 32 steps
+    void draw_steps(int begin, int end) {
+        for (int i=begin; i<end; i++) {
+            geometry.draw_steps(*this, rngs[i], xBits[i], yBits[i]);
+        }
+    }
+
+    // A handful of walkers (snowflake_2 has one) leaves the kernels with
+    // lanes to spare, so each walker takes all its steps in one scalar loop
+    // instead. Nothing is specialised: the settings are read as in
+    // step_walkers, and so are the moves and the random draws, the cluster
+    // does not change.
+    void step_few_walkers(int begin, int end, int steps, Scratch& s) {
+        Band band = geometry.band(*this);
+        Box box;
+        bool clamps = geometry.border(*this, box);
+        for (int i=begin; i<end; i++) {
+            Particle p {movingX[i], movingY[i]};
+            uint32_t xb(xBits[i]), yb(yBits[i]);
+            bool alive(true);
+            for (int k=0; k<steps; k++) {
+                // a stuck walker still draws and drops its bits
+                if ((phase+k) % 32 == 0)
+                    geometry.draw_steps(*this, rngs[i], xb, yb);
+                if (alive && !in_band(p.x, p.y, band)) {
+                    STATS_ONLY(s.counters.rejected++;)
+                }
+                else if (alive) {
+                    s.tests++;
+                    if (grid.touches(p.x, p.y) || geometry.touch_limit(*this, p)) {
+                        s.hits.push_back(Hit {k, i});
+                        alive = false;
+                    }
+                }
+                if (alive) {
+                    if (hop && geometry.jump(*this, p, rngs[i])) {
+                        STATS_ONLY(s.counters.jumps++;)
+                    }
+                    else {
+                        p.x += (xb & 1) ? 1 : -1;
+                        p.y += (yb & 1) ? 1 : -1;
+                    }
+                    if (clamps) {
+                        p.x = std::min(std::max(p.x, box.xMin), box.xMax);
+                        p.y = std::min(std::max(p.y, box.yMin), box.yMax);
+                    }
+                    s.steps++;
+                    if (geometry.after_step(*this, p, rngs[i])) {
+                        STATS_ONLY(s.counters.killed++;)
+                    }
+                }
+                xb >>= 1;
+                yb >>= 1;
+            }
+            movingX[i] = p.x;
+            movingY[i] = p.y;
+            xBits[i] = xb;
+            yBits[i] = yb;
+        }
+    }
+
+    // walkers [begin, end) take up to `steps` steps against the frozen cluster
+    void step_walkers(int begin, int end, int steps, Scratch& s) {
+        if (end-begin < FEW_WALKERS) {
+            step_few_walkers(begin, end, steps, s);
+            return;
+        }
+        const WalkerKernels& kernels = walker_kernels();
+        int n = end-begin;
+        int* x = movingX.data()+begin;
+        int* y = movingY.data()+begin;
+        int* alive = active.data()+begin;
+        s.near.resize(n);
+        s.mask.resize(n);
+        std::fill(alive, alive+n, -1);
+        Band band = geometry.band(*this);
+        Box box;
+        bool clamps = geometry.border(*this, box);
+
+        for (int k=0; k<steps; k++) {
+            if ((phase+k) % 32 == 0)
+                draw_steps(begin, end);
+            kernels.band(x, y, n, band, s.near.data());
+            for (int i=0; i<n; i++) {
+                if (!(alive[i] & s.near[i])) {
+                    STATS_ONLY(s.counters.rejected += alive[i] != 0;)
+                    continue;
+                }
+                s.tests++;
+                Particle p {x[i], y[i]};
+                if (grid.touches(p.x, p.y) || geometry.touch_limit(*this, p)) {
+                    s.hits.push_back(Hit {k, begin+i});
+                    alive[i] = 0;
+                }
+            }
+            const int* mask = alive;
+            if (hop) {
+                std::copy(alive, alive+n, s.mask.begin());
+                for (int i=0; i<n; i++) {
+                    Particle p {x[i], y[i]};
+                    if (alive[i] && geometry.jump(*this, p, rngs[begin+i])) {
+                        x[i] = p.x;
+                        y[i] = p.y;
+                        s.mask[i] = 0;
+                        STATS_ONLY(s.counters.jumps++;)
+                    }
+                }
+                mask = s.mask.data();
+            }
+            kernels.step(x, y, xBits.data()+begin, yBits.data()+begin, mask, n);
+            if (clamps) {
+                kernels.clamp(x, n, box.xMin, box.xMax);
+                kernels.clamp(y, n, box.yMin, box.yMax);
+            }
+            for (int i=0; i<n; i++) {
+                if (!alive[i])
+                    continue;
+                s.steps++;
+                Particle p {x[i], y[i]};
+                if (geometry.after_step(*this, p, rngs[begin+i])) {
+                    STATS_ONLY(s.counters.killed++;)
+                }
+                x[i] = p.x;
+                y[i] = p.y;
+            }
+        }
+    }
+
+    // one epoch: step in parallel, then commit the hits in order
+    void advance(int steps) {
+        int n = settings.maxSimultaneous;
+        for (Scratch& s : scratch) {
+            s.hits.clear();
+            s.steps = 0;
+            s.tests = 0;
+            STATS_ONLY(s.counters = StepCounters();)
+        }
+        {
+            STATS_ONLY(ScopedTimer timer(stats.stepTime);)
+            if (threads > 1) {
+                pool->run([&](int t) {
+                    step_walkers(n*t/threads, n*(t+1)/threads, steps, scratch[t]);
+                });
+            }
+            else {
+                step_walkers(0, n, steps, scratch[0]);
+            }
+        }
+        phase = (phase+steps) % 32;
+        for (const Scratch& s : scratch) {
+            walkerSteps += s.steps;
+            collisionTests += s.tests;
+            STATS_ONLY(stats.steps += s.steps;)
+            STATS_ONLY(stats.tests += s.tests;)
+            STATS_ONLY(stats.step.add(s.counters);)
+        }
+
+        STATS_ONLY(ScopedTimer timer(stats.commitTime);)
+        STATS_ONLY(int before = total_fixed();)
+
+        std::vector<Hit>& hits = scratch[0].hits;
+        for (int t=1; t<threads; t++) {
+            hits.insert(hits.end(), scratch[t].hits.begin(), scratch[t].hits.end());
+        }
+        std::sort(hits.begin(), hits.end());
+        for (const Hit& hit : hits) {
+            if (finished())
+                break;
+            fix(walker(hit.walker));
+            add_new_particle(hit.walker);
+        }
+        STATS_ONLY(stats.sticks += total_fixed() - before;)
+        stream.append(fixedParticles.data(), fixedParticles.size());
+    }
+
+    // the ticks since the last print, and the whole run at the end
+    void print_stats(bool end) {
+        if (!end && (!statsEvery || stats.ticks < (uint64_t)statsEvery))
+            return;
+        if (!end)
+            stats.print(std::cerr, "stats");
+        totalStats.add(stats);
+        stats = Stats();
+        if (end && totalStats.ticks)
+            totalStats.print(std::cerr, "stats total");
+    }
+
+    // what one timer tick of the GL programs does
+    void run(int iterations) {
+        // the walkers left once the cluster is complete would only be
+        // tested again and again
+        for (int i=0; i<iterations && !finished(); i+=epoch) {
+            advance(std::min(epoch, iterations-i));
+        }
+        checkpoint();
+        stream.flush();
+        if (analyticsFile.is_open() && finished() && analytics.count % analyticsEvery)
+            analytics.sample(analyticsFile, walkerSteps, pyramid.occupied);
+        if (frames.is_open() && finished() && total_fixed() % framesEvery)
+            frames.submit();
+        STATS_ONLY(stats.ticks++;)
+        STATS_ONLY(print_stats(false);)
+    }
+};
+
+// one "x y" line per fixed particle, in the order they stuck
+template <class Geometry>
+bool save_cluster(const Aggregation<Geometry>& dla, const char* path) {
+    std::ofstream file(path);
+    for (const Particle& p : dla.fixedParticles) {
+        file << p.x << " " << p.y << "\n";
+    }
+    return (bool)file;
+}
+
+// Options of the lattice programs, on the command line as --name value or
+// in a --config file (see config.h):
+//   seed N             seed of the random streams (default: the time)
+//   threads N          step the walkers on N threads
+//   epoch N            steps between two commits of the stuck walkers
+//   hop                accelerated walk: long jumps far from the cluster
+//   checkpoint PATH    save the run to PATH every checkpoint-every N
+//                      stuck particles (default 10000) and at the end
+//   resume PATH        carry on from a checkpoint
+//   stream PATH        write the fixed particles to PATH as they stick
+//   stats N            with -DDLA_STATS, print the counters every N ticks
+//   analytics PATH     write the cluster statistics to PATH every
+//                      analytics-every N stuck particles (default 1000)
+//   frames PATH        an image every frames-every N stuck particles
+//                      (default 1000), PNGs for a PATH like frames/%05d.png,
+//                      else a raw rgb24 video stream
+// and the settings, whose defaults are the #defines of each program:
+//   width, height, particles, walkers, dot-radius, overlap, circle-radius, fps
+template <class Geometry>
+bool set_option(Aggregation<Geometry>& dla, const std::string& name, const char* value) {
+    Settings& s = dla.settings;
+    if (name == "hop")
+        dla.hop = !value || std::atoi(value);
+    else if (!value)
+        return false;
+    else if (name == "seed")
+        dla.seed = std::strtoull(value, nullptr, 10);
+    else if (name == "threads")
+        dla.threads = std::max(1, std::atoi(value));
+    else if (name == "epoch")
+        dla.epoch = std::max(1, std::atoi(value));
+    else if (name == "checkpoint")
+        dla.checkpointPath = value;
+    else if (name == "checkpoint-every")
+        dla.checkpointEvery = std::max(1, std::atoi(value));
+    else if (name == "resume")
+        dla.resumePath = value;
+    else if (name == "stream")
+        dla.streamPath = value;
+    else if (name == "stats")
+        dla.statsEvery = std::max(0, std::atoi(value));
+    else if (name == "analytics")
+        dla.analyticsPath = value;
+    else if (name == "analytics-every")
+        dla.analyticsEvery = std::max(1, std::atoi(value));
+    else if (name == "frames")
+        dla.framesPath = value;
+    else if (name == "frames-every")
+        dla.framesEvery = std::max(1, std::atoi(value));
+    else if (name == "width")
+        s.width = std::max(1, std::atoi(value));
+    else if (name == "height")
+        s.height = std::max(1, std::atoi(value));
+    else if (name == "particles")
+        s.maxParticle = std::max(1, (int)std::atof(value));
+    else if (name == "walkers")
+        s.maxSimultaneous = std::max(1, std::atoi(value));
+    else if (name == "dot-radius")
+        s.dotRadius = std::max(1, std::atoi(value));
+    else if (name == "overlap")
+        s.overlapTol = std::atof(value);
+    else if (name == "circle-radius")
+        s.circleRadius = std::max(1, std::atoi(value));
+    else if (name == "fps")
+        s.fps = std::max(1, std::atoi(value));
+    else
+        return false;
+    return true;
+}
+
+// returns the first argument that is not an option, or nullptr
+template <class Geometry>
+const char* parse_options(int argc, char **argv, Aggregation<Geometry>& dla) {
+    return parse_command_line(argc, argv, {"hop"},
+        [&](const std::string& name, const char* value) {
+            return set_option(dla, name, value);
+        });
+}
+
+// main() of the headless builds: runs to maxParticle as fast as possible
+// and writes the cluster to the first argument (or defaultPath)
+template <class Geometry>
+int run_headless(Aggregation<Geometry>& dla, int iterations,
+                 int argc, char **argv, const char* defaultPath) {
+    const char* path = parse_options(argc, argv, dla);
+    if (!path)
+        path = defaultPath;
+    if (!dla.start())
+        return 1;
+    std::cout << "Seed " << dla.seed << "\n";
+
+    auto start(std::chrono::steady_clock::now());
+    while (!dla.finished()) {
+        dla.run(iterations);
+    }
+    dla.finish();
+    auto stop(std::chrono::steady_clock::now());
+    auto duration(std::chrono::duration_cast<std::chrono::milliseconds>(stop-start));
+    std::cout << "Finished in " << duration.count() << "ms\n";
+
+    if (!save_cluster(dla, path)) {
+        std::cerr << "Cannot write " << path << "\n";
+        return 1;
+    }
+    return 0;
+}
+
+// save_checkpoint and load_checkpoint are found when the templates above
+// are instantiated
+#include "checkpoint.h"
+
+#endif
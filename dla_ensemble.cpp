@@ -0,0 +1,299 @@
+
+/* Ensemble runner: many independent aggregations over a parameter grid */
+
+// g++ -O2 -pthread dla_ensemble.cpp -o dla_ensemble
+// dla_ensemble --variant wedge --seeds 1-1000 snowflakes.csv
+// dla_ensemble --variant center,circle --walkers 10,50 --hop 0,1 --seeds 1-20
+//
+// Every combination of the listed values and seeds is one simulation, run
+// headless on one thread with its own lattice and arena. The simulations
+// are spread over --threads workers (default: every core) by a
+// work-stealing pool and the results go to one CSV file, one line per
+// simulation in grid order whatever the scheduling. --clusters PATH also
+// writes every cluster to one cluster stream (see cluster_stream.h).
+//
+// Options, lists are comma separated, a setting left out takes the
+// default of the program the variant comes from:
+//   variant        center, bottom, circle, wedge (default wedge)
+//   seeds          "A-B" or a list (default 1-100)
+//   particles, walkers, width, height, dot-radius, overlap, circle-radius
+//   hop            0 or 1, for center and circle
+//   threads N, clusters PATH, config FILE
+
+#include <iostream>
+#include <fstream>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+
+#include "dla_core.h"
+#include "dla_geometry.h"
+#include "work_stealing.h"
+
+struct Job {
+    std::string variant;
+    Settings settings;
+    bool hop;
+    uint64_t seed;
+};
+
+struct Result {
+    int particles;
+    uint64_t steps, tests;
+    double seconds;
+    double gyration; // radius of gyration of the cluster
+    double front;    // farthest (center, wedge), highest (bottom), closest (circle)
+    std::vector<Particle> cluster; // only with --clusters
+};
+
+// the #defines and tick lengths of the programs
+struct Variant {
+    const char* name;
+    Settings settings;
+    int iterations;
+};
+
+const Variant VARIANTS[] = {
+    {"center", {600, 600, 10000, 100, 1, 0, 0, 1}, 10000},     // DiffusionLimitedAggregation.cpp
+    {"bottom", {600, 600, 50000, 50, 1, 0, 0, 10}, 10000},     // DLA_bottom.cpp
+    {"circle", {500, 500, 20000, 50, 1, 0, 230, 10}, 100000},  // DLA_circle.cpp
+    {"wedge", {600, 600, 3000, 1, 1, 0, 0, 50}, 1000},         // snowflake_2.cpp
+};
+
+float front(const Aggregation<CenterSeed>& dla) {
+    return dla.geometry.farthest;
+}
+float front(const Aggregation<Substrate>& dla) {
+    return dla.geometry.highest;
+}
+float front(const Aggregation<Ring>& dla) {
+    return dla.geometry.closest;
+}
+float front(const Aggregation<Wedge>& dla) {
+    float farthest(0);
+    for (const Particle& p : dla.fixedParticles) {
+        farthest = std::max(farthest, std::sqrt((float)p.x*p.x + (float)p.y*p.y));
+    }
+    return farthest;
+}
+
+// the same cluster as the headless program with the same seed and settings
+template <class Geometry>
+void simulate(const Job& job, int iterations, bool keepCluster, Result& result) {
+    // the aggregation is large, it lives on the heap
+    std::unique_ptr<Aggregation<Geometry>> dla(new Aggregation<Geometry>(job.settings));
+    dla->seed = job.seed;
+    dla->hop = job.hop;
+    dla->init_particles();
+    auto start(std::chrono::steady_clock::now());
+    while (!dla->finished()) {
+        dla->run(iterations);
+    }
+    auto stop(std::chrono::steady_clock::now());
+
+    result.particles = dla->total_fixed();
+    result.steps = dla->walkerSteps;
+    result.tests = dla->collisionTests;
+    result.seconds = std::chrono::duration<double>(stop-start).count();
+    double cx(0), cy(0), r2(0);
+    for (const Particle& p : dla->fixedParticles) {
+        cx += p.x;
+        cy += p.y;
+        r2 += (double)p.x*p.x + (double)p.y*p.y;
+    }
+    int n = std::max(1, result.particles);
+    cx /= n;
+    cy /= n;
+    result.gyration = std::sqrt(std::max(0.0, r2/n - cx*cx - cy*cy));
+    result.front = front(*dla);
+    if (keepCluster)
+        result.cluster.assign(dla->fixedParticles.begin(), dla->fixedParticles.end());
+}
+
+std::vector<std::string> split(const std::string& list) {
+    std::vector<std::string> items;
+    size_t begin(0);
+    while (begin <= list.size()) {
+        size_t end = list.find(',', begin);
+        if (end == std::string::npos)
+            end = list.size();
+        if (end > begin)
+            items.push_back(list.substr(begin, end-begin));
+        begin = end+1;
+    }
+    return items;
+}
+
+std::vector<uint64_t> parse_seeds(const std::string& text) {
+    std::vector<uint64_t> seeds;
+    size_t dash = text.find('-');
+    if (dash != std::string::npos) {
+        uint64_t first = std::strtoull(text.c_str(), nullptr, 10);
+        uint64_t last = std::strtoull(text.c_str()+dash+1, nullptr, 10);
+        for (uint64_t s=first; s<=last; s++) {
+            seeds.push_back(s);
+        }
+        return seeds;
+    }
+    for (const std::string& s : split(text)) {
+        seeds.push_back(std::strtoull(s.c_str(), nullptr, 10));
+    }
+    return seeds;
+}
+
+// one list of values per setting, empty for the default of the variant
+typedef std::map<std::string, std::vector<std::string>> Grid;
+
+void set_setting(Settings& s, const std::string& name, const std::string& value) {
+    int v = (int)std::atof(value.c_str());
+    if (name == "particles")
+        s.maxParticle = std::max(1, v);
+    else if (name == "walkers")
+        s.maxSimultaneous = std::max(1, v);
+    else if (name == "width")
+        s.width = std::max(1, v);
+    else if (name == "height")
+        s.height = std::max(1, v);
+    else if (name == "dot-radius")
+        s.dotRadius = std::max(1, v);
+    else if (name == "overlap")
+        s.overlapTol = std::atof(value.c_str());
+    else if (name == "circle-radius")
+        s.circleRadius = std::max(1, v);
+}
+
+const char* SETTINGS[] = {"particles", "walkers", "width", "height",
+                          "dot-radius", "overlap", "circle-radius"};
+
+// the cartesian product of the grid, the seeds vary fastest
+std::vector<Job> expand(const Grid& grid, const std::vector<uint64_t>& seeds,
+                        std::vector<int>& iterations) {
+    std::vector<Job> jobs;
+    for (const std::string& name : grid.at("variant")) {
+        const Variant* variant(nullptr);
+        for (const Variant& v : VARIANTS) {
+            if (name == v.name)
+                variant = &v;
+        }
+        if (!variant) {
+            std::cerr << "Unknown variant " << name << "\n";
+            std::exit(2);
+        }
+        std::vector<Job> partial {Job {name, variant->settings, false, 0}};
+        for (const char* setting : SETTINGS) {
+            auto values = grid.find(setting);
+            if (values == grid.end())
+                continue;
+            std::vector<Job> next;
+            for (const Job& job : partial) {
+                for (const std::string& value : values->second) {
+                    next.push_back(job);
+                    set_setting(next.back().settings, setting, value);
+                }
+            }
+            partial.swap(next);
+        }
+        std::vector<std::string> hops {"0"};
+        if (grid.count("hop"))
+            hops = grid.at("hop");
+        for (const Job& job : partial) {
+            for (const std::string& hop : hops) {
+                for (uint64_t seed : seeds) {
+                    jobs.push_back(job);
+                    jobs.back().hop = std::atoi(hop.c_str());
+                    jobs.back().seed = seed;
+                    iterations.push_back(variant->iterations);
+                }
+            }
+        }
+    }
+    return jobs;
+}
+
+int main(int argc, char **argv) {
+    Grid grid;
+    std::string seedText("1-100");
+    std::string clustersPath;
+    int threads = std::max(1u, std::thread::hardware_concurrency());
+    const char* output = parse_command_line(argc, argv, {},
+        [&](const std::string& name, const char* value) {
+            if (!value)
+                return false;
+            if (name == "seeds")
+                seedText = value;
+            else if (name == "threads")
+                threads = std::max(1, std::atoi(value));
+            else if (name == "clusters")
+                clustersPath = value;
+            else if (name == "variant" || name == "hop"
+                     || std::find(std::begin(SETTINGS), std::end(SETTINGS), name) != std::end(SETTINGS))
+                grid[name] = split(value);
+            else
+                return false;
+            return true;
+        });
+    if (!output)
+        output = "dla_ensemble.csv";
+    if (!grid.count("variant"))
+        grid["variant"] = {"wedge"};
+
+    std::vector<int> iterations;
+    std::vector<Job> jobs = expand(grid, parse_seeds(seedText), iterations);
+    std::vector<Result> results(jobs.size());
+    std::cerr << jobs.size() << " simulations on " << threads << " threads\n";
+
+    bool keepClusters = !clustersPath.empty();
+    auto start(std::chrono::steady_clock::now());
+    WorkStealingPool pool(threads);
+    pool.run((int)jobs.size(), [&](int task, int) {
+        const Job& job = jobs[task];
+        if (job.variant == "center")
+            simulate<CenterSeed>(job, iterations[task], keepClusters, results[task]);
+        else if (job.variant == "bottom")
+            simulate<Substrate>(job, iterations[task], keepClusters, results[task]);
+        else if (job.variant == "circle")
+            simulate<Ring>(job, iterations[task], keepClusters, results[task]);
+        else
+            simulate<Wedge>(job, iterations[task], keepClusters, results[task]);
+    });
+    auto stop(std::chrono::steady_clock::now());
+    double seconds = std::chrono::duration<double>(stop-start).count();
+    std::cerr << "Finished in " << seconds << "s, "
+              << jobs.size()/seconds << " simulations/s\n";
+
+    std::ofstream file(output);
+    file << "id,variant,seed,particles,walkers,width,height,dot_radius,overlap,"
+            "circle_radius,hop,steps,tests,seconds,gyration,front\n";
+    for (size_t i=0; i<jobs.size(); i++) {
+        const Job& j = jobs[i];
+        const Settings& s = j.settings;
+        const Result& r = results[i];
+        file << i << "," << j.variant << "," << j.seed << "," << r.particles << ","
+             << s.maxSimultaneous << "," << s.width << "," << s.height << ","
+             << s.dotRadius << "," << s.overlapTol << "," << s.circleRadius << ","
+             << j.hop << "," << r.steps << "," << r.tests << "," << r.seconds << ","
+             << r.gyration << "," << r.front << "\n";
+    }
+    if (!file) {
+        std::cerr << "Cannot write " << output << "\n";
+        return 1;
+    }
+
+    if (keepClusters) {
+        ClusterStream stream;
+        if (!stream.open(clustersPath.c_str())) {
+            std::cerr << "Cannot write " << clustersPath << "\n";
+            return 1;
+        }
+        for (const Result& r : results) {
+            stream.restart();
+            stream.append(r.cluster.data(), r.cluster.size());
+        }
+    }
+    return 0;
+}
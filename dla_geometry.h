@@ -0,0 +1,306 @@
+/* Geometry policies of the lattice variants, see dla_core.h */
+
+#ifndef DLA_GEOMETRY_H
+#define DLA_GEOMETRY_H
+
+#include <cmath>
+#include <climits>
+#include <algorithm>
+
+#include "dla_core.h"
+
+const float DEG_TO_RAD = 3.1415926/180.0;
+
+// 32 steps with +1 and -1 equally likely on both axes, from one draw
+inline void even_steps(Rng& rng, uint32_t& xBits, uint32_t& yBits) {
+    xBits = rng.take(32);
+    yBits = rng.take(32);
+}
+
+// 32 steps with +1 drawn with probability 1/3
+inline uint32_t third_steps(Rng& rng) {
+    uint32_t bits(0);
+    for (int i=0; i<32; i++) {
+        bits |= (uint32_t)rng.one_in_three() << i;
+    }
+    return bits;
+}
+
+// DiffusionLimitedAggregation.cpp
+// A seed in the center, walkers start on a ring at farthest+10 and are
+// sent back to it when they wander past farthest+20, where their walk
+// would have crossed it first (see reinject).
+// With dla.hop the walkers are not clamped to the window, they jump when
+// the cluster is far (see Aggregation::jump) and are sent back past the
+// kill radius.
+struct CenterSeed {
+    // distance of the farthest particle from the center
+    float farthest = 10;
+
+    static float distance_from_center(const Particle& p) {
+        return std::sqrt(p.x*p.x + p.y*p.y);
+    }
+
+    float kill_radius() const {
+        return 4*farthest + 50;
+    }
+
+    template <class A> void init(A& dla) {
+        // the walkers are clamped to the window so the grid covers all of it
+        const Settings& s = dla.settings;
+        dla.init_lattice(-s.width/2, -s.height/2, s.width/2, s.height/2);
+        dla.fix(Particle {0, 0});
+    }
+    template <class A> Particle spawn(A&, Rng& rng) {
+        int radius = farthest+10;
+        float angle = rng.below(360);
+        angle *= DEG_TO_RAD;
+        return Particle {(int)(radius*std::cos(angle)), (int)(radius*std::sin(angle))};
+    }
+    // A walker at r beyond the launch ring R will cross it, at an angle phi
+    // from its own with the density of the Poisson kernel outside a circle,
+    // (r^2-R^2) / 2pi(r^2 - 2rR cos phi + R^2). Sampled by inversion:
+    // tan(phi/2) = (r-R)/(r+R) tan(pi(u-1/2)). Putting it there keeps the
+    // harmonic measure of a walk that was never stopped, without walking
+    // back from afar; a walker spawned anew would forget where it was.
+    template <class A> Particle reinject(A& dla, const Particle& p, Rng& rng) {
+        int radius = farthest+10;
+        double r = distance_from_center(p);
+        if (r <= radius)
+            return spawn(dla, rng);
+        double u = rng.uniform();
+        double phi = 2*std::atan((r-radius)/(r+radius) * std::tan(3.14159265358979*(u-0.5)));
+        double angle = std::atan2((double)p.y, (double)p.x) + phi;
+        return Particle {(int)(radius*std::cos(angle)), (int)(radius*std::sin(angle))};
+    }
+    template <class A> void draw_steps(A&, Rng& rng, uint32_t& xBits, uint32_t& yBits) {
+        even_steps(rng, xBits, yBits);
+    }
+    template <class A> bool border(A& dla, Box& box) {
+        const Settings& s = dla.settings;
+        box = Box {-s.width/2, -s.height/2, s.width/2, s.height/2};
+        return !dla.hop;
+    }
+    // the pyramid bound, or r-farthest outside of the cluster
+    template <class A> bool jump(A& dla, Particle& p, Rng& rng) {
+        float bound = dla.distance_bound(p);
+        float r2 = (float)p.x*p.x + (float)p.y*p.y;
+        if (r2 > (farthest+bound)*(farthest+bound))
+            bound = std::sqrt(r2) - farthest;
+        return dla.jump(p, bound, rng);
+    }
+    template <class A> bool after_step(A& dla, Particle& p, Rng& rng) {
+        float kill = dla.hop ? kill_radius() : farthest+20;
+        if ((float)p.x*p.x + (float)p.y*p.y <= kill*kill)
+            return false;
+        p = reinject(dla, p, rng);
+        return true;
+    }
+    template <class A> Band band(A& dla) {
+        float reach = farthest + dla.collision_distance() + 1;
+        return Band {BAND_INSIDE, reach*reach};
+    }
+    template <class A> bool touch_limit(A&, const Particle&) {
+        return false;
+    }
+    template <class A> void on_stick(A& dla, const Particle& p) {
+        float dist = distance_from_center(p);
+        if (dist > farthest)
+            farthest = dist+dla.settings.dotRadius;
+    }
+    template <class A> float growth_distance(A&, const Particle& p) {
+        return distance_from_center(p);
+    }
+    template <class A> Box view(A& dla) {
+        const Settings& s = dla.settings;
+        return Box {-s.width/2, -s.height/2, s.width/2, s.height/2};
+    }
+    template <class A> int copies(A&) {
+        return 1;
+    }
+};
+
+// DLA_bottom.cpp
+// Walkers start on the top edge (or 50 above the cluster, whichever is
+// higher), drift down and stick to the floor.
+// The walk is biased so it cannot jump like the others, the pyramid is
+// kept up to date all the same.
+struct Substrate {
+    // height of the highest particle
+    float highest = 0;
+
+    template <class A> void init(A& dla) {
+        // walkers may drift a little above the spawn line or below the floor
+        // before they are caught, the margins keep them on the grid
+        const Settings& s = dla.settings;
+        dla.init_lattice(0, -s.height, s.width, 2*s.height);
+        highest = s.dotRadius*2;
+    }
+    // on the top edge, or above the cluster once it gets close to it: the
+    // lattice has no top, the cluster grows for as long as it is fed
+    template <class A> Particle spawn(A& dla, Rng& rng) {
+        int top = std::max(dla.settings.height, (int)highest + 50);
+        return Particle {(int)rng.below(dla.settings.width), top};
+    }
+    // the walkers drift down
+    template <class A> void draw_steps(A&, Rng& rng, uint32_t& xBits, uint32_t& yBits) {
+        xBits = rng.take(32);
+        yBits = third_steps(rng);
+    }
+    template <class A> bool border(A& dla, Box& box) {
+        box = Box {0, INT_MIN, dla.settings.width, INT_MAX};
+        return true;
+    }
+    template <class A> bool jump(A&, Particle&, Rng&) {
+        return false;
+    }
+    template <class A> bool after_step(A&, Particle&, Rng&) {
+        return false;
+    }
+    template <class A> Band band(A& dla) {
+        return Band {BAND_BELOW, highest + dla.collision_distance()};
+    }
+    template <class A> bool touch_limit(A& dla, const Particle& p) {
+        return p.y <= dla.settings.dotRadius;
+    }
+    template <class A> void on_stick(A& dla, const Particle& p) {
+        if (p.y > highest)
+            highest = p.y+dla.settings.dotRadius*2;
+    }
+    template <class A> float growth_distance(A&, const Particle& p) {
+        return p.y;
+    }
+    template <class A> Box view(A& dla) {
+        return Box {0, 0, dla.settings.width, dla.settings.height};
+    }
+    template <class A> int copies(A&) {
+        return 1;
+    }
+};
+
+// DLA_circle.cpp
+// Walkers start from the center and stick to a circle of circleRadius.
+struct Ring {
+    // distance of the particle closest to the center
+    float closest = 0;
+
+    template <class A> void init(A& dla) {
+        // walkers are caught as soon as they reach the circle
+        int R = dla.settings.circleRadius+2;
+        dla.init_lattice(-R, -R, R, R);
+        closest = dla.settings.circleRadius-5;
+    }
+    template <class A> Particle spawn(A&, Rng&) {
+        return Particle {0, 0};
+    }
+    template <class A> void draw_steps(A&, Rng& rng, uint32_t& xBits, uint32_t& yBits) {
+        even_steps(rng, xBits, yBits);
+    }
+    template <class A> bool border(A&, Box&) {
+        return false;
+    }
+    // with dla.hop the walkers jump while both the cluster and the circle
+    // are far enough
+    template <class A> bool jump(A& dla, Particle& p, Rng& rng) {
+        float bound = dla.distance_bound(p);
+        if (bound <= 0)
+            return false;
+        float wall = dla.settings.circleRadius - std::sqrt(p.x*p.x + p.y*p.y);
+        return dla.jump(p, std::min(bound, wall), rng);
+    }
+    template <class A> bool after_step(A&, Particle&, Rng&) {
+        return false;
+    }
+    template <class A> Band band(A& dla) {
+        float reach = std::max(0.0f, closest - dla.collision_distance() - 1);
+        return Band {BAND_OUTSIDE, reach*reach};
+    }
+    template <class A> bool touch_limit(A& dla, const Particle& p) {
+        int R = dla.settings.circleRadius;
+        return p.x*p.x + p.y*p.y >= R*R;
+    }
+    template <class A> void on_stick(A&, const Particle& p) {
+        float dist = std::sqrt(p.x*p.x + p.y*p.y);
+        if (dist < closest)
+            closest = dist;
+    }
+    // depth into the circle
+    template <class A> float growth_distance(A& dla, const Particle& p) {
+        return dla.settings.circleRadius - std::sqrt(p.x*p.x + p.y*p.y);
+    }
+    template <class A> Box view(A& dla) {
+        const Settings& s = dla.settings;
+        return Box {-s.width/2, -s.height/2, s.width/2, s.height/2};
+    }
+    template <class A> int copies(A&) {
+        return 1;
+    }
+};
+
+// snowflake_2.cpp
+// A seed in the center, walkers come from the right and are kept in the
+// wedge between -PI/6 and PI/6, the picture is made by symmetry.
+struct Wedge {
+    // the walkers are kept within 30 degrees of the x axis, 30 degrees
+    // from it is x = sqrt(3)*|y|: above the wedge is y > 0 with x < 0 or
+    // x^2 < 3y^2, no angle needed. On the axis the walkers left of the
+    // seed count as below it, as acos gave -PI there.
+    static bool above(const Particle& p) {
+        return p.y > 0 && (p.x < 0 || (long)p.x*p.x < 3L*p.y*p.y);
+    }
+    static bool below(const Particle& p) {
+        return p.y <= 0 && (p.x < 0 || (long)p.x*p.x < 3L*p.y*p.y);
+    }
+
+    template <class A> void init(A& dla) {
+        // nothing sticks outside of the wedge, the lattice only covers it
+        // and the margin a walker may step out of it before it is put back
+        const Settings& s = dla.settings;
+        int margin = (int)std::ceil(dla.collision_distance()) + 2;
+        int half = std::min(s.height/2, (int)std::ceil(s.width/2 / std::sqrt(3.0)) + margin);
+        dla.init_lattice(std::max(-s.width/2, -margin), -half, s.width/2, half);
+        dla.fix(Particle {0, 0});
+    }
+    template <class A> Particle spawn(A& dla, Rng&) {
+        return Particle {dla.settings.width, 0};
+    }
+    // the walkers drift to the left
+    template <class A> void draw_steps(A&, Rng& rng, uint32_t& xBits, uint32_t& yBits) {
+        xBits = third_steps(rng);
+        yBits = rng.take(32);
+    }
+    template <class A> bool border(A&, Box&) {
+        return false;
+    }
+    template <class A> bool jump(A&, Particle&, Rng&) {
+        return false;
+    }
+    template <class A> bool after_step(A& dla, Particle& p, Rng&) {
+        if (above(p))
+            p.y--;
+        else if (below(p))
+            p.y++;
+        if (p.x > dla.settings.width/2)
+            p.x--;
+        return false;
+    }
+    template <class A> Band band(A&) {
+        return Band {BAND_ALL, 0};
+    }
+    template <class A> bool touch_limit(A&, const Particle&) {
+        return false;
+    }
+    template <class A> void on_stick(A&, const Particle&) {}
+    template <class A> float growth_distance(A&, const Particle& p) {
+        return std::sqrt(p.x*p.x + p.y*p.y);
+    }
+    template <class A> Box view(A& dla) {
+        const Settings& s = dla.settings;
+        return Box {-s.width/2, -s.height/2, s.width/2, s.height/2};
+    }
+    template <class A> int copies(A&) {
+        return 6;
+    }
+};
+
+#endif
@@ -0,0 +1,310 @@
+/* DLA_bottom.cpp split into strips, one process each */
+
+// g++ -O2 -pthread dla_strips.cpp -o dla_strips
+// dla_strips [--strips N] [--seed N] [--particles N] [--walkers N]
+//            [--width N] [--height N] [cluster.txt]
+//
+// The substrate model of DLA_bottom.cpp for floors too wide for one
+// process: the floor is cut in --strips strips of columns (default: one per
+// core), each run by a process of its own with its own lattice, walkers and
+// random stream, so nothing is written by two of them.
+// The strips only talk to their neighbours, through rings in shared memory
+// (strip_exchange.h):
+//   a walker stepping over the edge of a strip is handed to the neighbour
+//   a particle sticking within the collision distance of the edge is sent
+//   to the neighbour as a ghost, which marks its lattice but is not its own
+// What is shared by all is two counters: the rank handed to each particle
+// that sticks, which stops every strip at --particles, and the top of the
+// cluster, where the walkers start as in DLA_bottom.cpp.
+// The strips run freely, there are no epochs as with --threads, so a
+// ghost can reach a neighbour a few steps after a walker there touched the
+// same spot, and the cluster is not the one DLA_bottom.cpp grows with the
+// same seed, nor twice the same. Messages of one strip to a neighbour
+// keep their order, so a walker never arrives before the particles that
+// stuck before it left.
+// The cluster is written as "x y" lines in the order the particles stuck.
+
+#include <iostream>
+#include <fstream>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <ctime>
+#include <cstdlib>
+
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "dla_core.h"
+#include "strip_exchange.h"
+
+#define WIDTH 600
+#define HEIGHT 600
+#define MAX_PARTICLE 50000
+#define MAX_SIMULTANEOUS 50
+#define DOT_RADIUS 1
+#define OVERLAP_TOL 0
+
+// steps a walker takes before the next one moves, the inbox is read after
+// every walker has taken them
+const int STEPS = 64;
+
+// one strip, in its own process
+struct Strip {
+    enum Result { WALKING, STUCK, LEFT, RIGHT };
+
+    const Settings& settings;
+    StripMemory& memory;
+    int index, count;
+    int x0, x1; // owns the columns [x0, x1)
+    int reach;  // a particle this close to an edge is a ghost next door
+    OccupancyGrid grid;
+    Rng rng;
+    std::vector<Particle> walkers;
+    StuckParticle* particles;
+    StripMemory::Strip& shared;
+    uint64_t steps = 0; // copied to shared when the strip is done
+
+    Strip(const Settings& s, StripMemory& memory, int index, int count, uint64_t seed)
+        : settings(s), memory(memory), index(index), count(count),
+          particles(memory.particles(index)), shared(memory.strip(index)) {
+        x0 = s.width*index/count;
+        // the walkers are clamped to [0, width], the last strip has width
+        x1 = index == count-1 ? s.width+1 : s.width*(index+1)/count;
+        float cd = collision_distance();
+        reach = (int)std::ceil(cd);
+        // past the window the lattice grows as needed
+        grid.init(x0-reach, -s.height, x1+reach, 2*s.height, cd);
+        rng.seed(seed, index);
+        // the walkers of DLA_bottom.cpp, shared out by width
+        int n = s.maxSimultaneous*(index+1)/count - s.maxSimultaneous*index/count;
+        for (int i=0; i<n; i++) {
+            walkers.push_back(spawn());
+        }
+    }
+
+    float collision_distance() const {
+        return settings.dotRadius*2 - settings.overlapTol;
+    }
+
+    bool finished() const {
+        return memory.header().claimed.load(std::memory_order_relaxed) >= (uint32_t)settings.maxParticle;
+    }
+
+    // on the spawn line of DLA_bottom.cpp, above this strip
+    Particle spawn() {
+        int top = std::max(settings.height, memory.header().highest.load(std::memory_order_relaxed) + 50);
+        int columns = std::min(x1, settings.width) - x0;
+        return Particle {x0 + (int)rng.below(std::max(1, columns)), top};
+    }
+
+    // the DLA_bottom.cpp walk: test, then one diagonal step, down two times
+    // out of three
+    Result walk(Particle& p) {
+        for (int k=0; k<STEPS; k++) {
+            if (grid.touches(p.x, p.y) || p.y <= settings.dotRadius)
+                return STUCK;
+            p.x += rng.bit() ? 1 : -1;
+            p.y += rng.one_in_three() ? 1 : -1;
+            p.x = std::min(std::max(p.x, 0), settings.width);
+            steps++;
+            if (p.x < x0)
+                return LEFT;
+            if (p.x >= x1)
+                return RIGHT;
+        }
+        return WALKING;
+    }
+
+    // waits while the neighbour's inbox is full, reading ours meanwhile so
+    // two full rings cannot wait on each other
+    void send(StripRing& ring, const StripMessage& m) {
+        while (!ring.push(m)) {
+            if (finished())
+                return;
+            receive();
+            std::this_thread::yield();
+        }
+    }
+
+    void receive() {
+        StripMessage m;
+        if (index > 0) {
+            while (memory.strip(index-1).toRight.pop(m)) {
+                take(m);
+            }
+        }
+        if (index < count-1) {
+            while (memory.strip(index+1).toLeft.pop(m)) {
+                take(m);
+            }
+        }
+    }
+
+    void take(const StripMessage& m) {
+        if (m.kind == StripMessage::WALKER)
+            walkers.push_back(Particle {m.x, m.y});
+        else
+            grid.add(m.x, m.y);
+    }
+
+    // false once every particle is handed out
+    bool stick(const Particle& p) {
+        uint32_t order = memory.header().claimed.fetch_add(1, std::memory_order_relaxed);
+        if (order >= (uint32_t)settings.maxParticle)
+            return false;
+        particles[shared.fixed++] = StuckParticle {p.x, p.y, order};
+        grid.add(p.x, p.y);
+        std::atomic<int>& highest = memory.header().highest;
+        int h = highest.load(std::memory_order_relaxed);
+        while (p.y > h && !highest.compare_exchange_weak(h, p.y + settings.dotRadius*2,
+                                                         std::memory_order_relaxed)) {}
+        if (index > 0 && p.x < x0 + reach) {
+            send(shared.toLeft, StripMessage {StripMessage::GHOST, p.x, p.y});
+            shared.ghosts++;
+        }
+        if (index < count-1 && p.x >= x1 - reach) {
+            send(shared.toRight, StripMessage {StripMessage::GHOST, p.x, p.y});
+            shared.ghosts++;
+        }
+        return true;
+    }
+
+    void run() {
+        walk_all();
+        shared.steps = steps;
+    }
+
+    void walk_all() {
+        while (!finished()) {
+            receive();
+            if (walkers.empty()) {
+                std::this_thread::yield();
+                continue;
+            }
+            // send() may read the inbox and add walkers, so no reference
+            // into the list is held across it
+            for (size_t i=0; i<walkers.size(); ) {
+                Particle p = walkers[i];
+                Result result = walk(p);
+                walkers[i] = p;
+                if (result == STUCK) {
+                    if (!stick(p))
+                        return;
+                    walkers[i] = spawn();
+                }
+                else if (result != WALKING) {
+                    StripRing& ring = result == LEFT ? shared.toLeft : shared.toRight;
+                    send(ring, StripMessage {StripMessage::WALKER, p.x, p.y});
+                    shared.handoffs++;
+                    walkers[i] = walkers.back();
+                    walkers.pop_back();
+                    continue;
+                }
+                i++;
+            }
+        }
+    }
+};
+
+int main(int argc, char **argv) {
+    Settings settings {WIDTH, HEIGHT, MAX_PARTICLE, MAX_SIMULTANEOUS, DOT_RADIUS, OVERLAP_TOL, 0, 0};
+    uint64_t seed = std::time(0);
+    int strips = std::max(1u, std::thread::hardware_concurrency());
+    const char* path = parse_command_line(argc, argv, {},
+        [&](const std::string& name, const char* value) {
+            if (!value)
+                return false;
+            if (name == "strips")
+                strips = std::max(1, std::atoi(value));
+            else if (name == "seed")
+                seed = std::strtoull(value, nullptr, 10);
+            else if (name == "particles")
+                settings.maxParticle = std::max(1, (int)std::atof(value));
+            else if (name == "walkers")
+                settings.maxSimultaneous = std::max(1, std::atoi(value));
+            else if (name == "width")
+                settings.width = std::max(1, std::atoi(value));
+            else if (name == "height")
+                settings.height = std::max(1, std::atoi(value));
+            else if (name == "dot-radius")
+                settings.dotRadius = std::max(1, std::atoi(value));
+            else if (name == "overlap")
+                settings.overlapTol = std::atof(value);
+            else
+                return false;
+            return true;
+        });
+    if (!path)
+        path = "dla_strips.txt";
+    // a strip narrower than the collision distance would pass ghosts on
+    strips = std::min(strips, std::max(1, settings.width / (4*settings.dotRadius)));
+
+    StripMemory memory;
+    // any strip may end up with every particle
+    if (!memory.create(strips, settings.maxParticle)) {
+        std::cerr << "Cannot map the shared memory of " << strips << " strips\n";
+        return 1;
+    }
+    memory.header().highest.store(settings.dotRadius*2);
+    std::cout << "Seed " << seed << ", " << strips << " strips\n";
+
+    auto start(std::chrono::steady_clock::now());
+    std::vector<pid_t> children;
+    for (int i=0; i<strips; i++) {
+        pid_t pid = fork();
+        if (pid < 0) {
+            std::cerr << "Cannot start strip " << i << "\n";
+            // the others stop at once
+            memory.header().claimed.store(settings.maxParticle);
+            break;
+        }
+        if (pid == 0) {
+            Strip strip(settings, memory, i, strips, seed);
+            strip.run();
+            _exit(0);
+        }
+        children.push_back(pid);
+    }
+    bool failed = (int)children.size() < strips;
+    for (pid_t pid : children) {
+        int status;
+        if (waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status))
+            failed = true;
+    }
+    if (failed) {
+        std::cerr << "A strip failed\n";
+        return 1;
+    }
+    auto stop(std::chrono::steady_clock::now());
+    auto duration(std::chrono::duration_cast<std::chrono::milliseconds>(stop-start));
+    std::cout << "Finished in " << duration.count() << "ms\n";
+
+    // back in sticking order
+    std::vector<Particle> cluster(settings.maxParticle);
+    uint64_t steps(0), handoffs(0), ghosts(0);
+    for (int i=0; i<strips; i++) {
+        const StripMemory::Strip& s = memory.strip(i);
+        const StuckParticle* particles = memory.particles(i);
+        for (uint32_t j=0; j<s.fixed; j++) {
+            cluster[particles[j].order] = Particle {particles[j].x, particles[j].y};
+        }
+        steps += s.steps;
+        handoffs += s.handoffs;
+        ghosts += s.ghosts;
+    }
+    std::cout << steps << " steps, " << handoffs << " walkers handed over, "
+              << ghosts << " ghosts\n";
+
+    std::ofstream file(path);
+    for (const Particle& p : cluster) {
+        file << p.x << " " << p.y << "\n";
+    }
+    if (!file) {
+        std::cerr << "Cannot write " << path << "\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,270 @@
+/* Offscreen frames of a growing cluster */
+
+#ifndef FRAME_EXPORT_H
+#define FRAME_EXPORT_H
+
+#include <iostream>
+#include <cstdio>
+#include <cstdint>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+
+// The cluster drawn into a plain RGB canvas, no GL needed.
+// The canvas is kept between frames and each particle is painted once, when
+// it sticks, coloured by its sticking order from blue to red. A frame is a
+// copy of the canvas handed to an encoder thread, so writing the files
+// overlaps with the simulation; at most MAX_QUEUED frames wait, beyond
+// that submit() waits for the encoder rather than piling up memory.
+// A path with a printf pattern (frames/%05d.png) gives one PNG per frame,
+// any other path one raw rgb24 video stream, for example
+//   ffmpeg -f rawvideo -pix_fmt rgb24 -s 600x600 -r 25 -i growth.rgb growth.mp4
+class FrameExporter {
+public:
+    static const int MAX_QUEUED = 4;
+
+    FrameExporter() {}
+    FrameExporter(const FrameExporter&) = delete;
+    FrameExporter& operator=(const FrameExporter&) = delete;
+
+    ~FrameExporter() {
+        close();
+    }
+
+    // the canvas shows [xMin, xMax] x [yMin, yMax] of the lattice, every
+    // particle is also painted in copies-1 rotated and flipped copies (6
+    // for a snowflake grown in one wedge)
+    bool open(const std::string& path, int xMin, int yMin, int xMax, int yMax,
+              int copies, int radius, long particles) {
+        close();
+        if (path.find('%') == std::string::npos) {
+            raw = std::fopen(path.c_str(), "wb");
+            if (!raw)
+                return false;
+        }
+        this->path = path;
+        minX = xMin;
+        minY = yMin;
+        width = xMax - xMin;
+        height = yMax - yMin;
+        // rotated by 0, 120 and 240 degrees, then the same flipped around
+        // the y axis
+        rotations.clear();
+        for (int k=0; k<copies; k++) {
+            rotations.push_back(std::cos(2.0943951*(k%3)));
+            rotations.push_back(std::sin(2.0943951*(k%3)));
+        }
+        this->radius = radius;
+        total = std::max(1L, particles);
+        canvas.assign((size_t)width*height*3, 0);
+        frames = 0;
+        failed = false;
+        stopping = false;
+        encoder = std::thread(&FrameExporter::encode, this);
+        return true;
+    }
+
+    bool is_open() const {
+        return encoder.joinable();
+    }
+
+    // a new cluster
+    void clear() {
+        std::fill(canvas.begin(), canvas.end(), 0);
+    }
+
+    // the order-th particle to stick
+    void paint(int x, int y, long order) {
+        unsigned char rgb[3];
+        order_color((double)order / total, rgb);
+        for (size_t k=0; k<rotations.size()/2; k++) {
+            double c(rotations[2*k]), s(rotations[2*k+1]);
+            double X = c*x - s*y, Y = s*x + c*y;
+            if (k >= 3)
+                X = -X;
+            disc((int)std::lround(X), (int)std::lround(Y), rgb);
+        }
+    }
+
+    // hands the canvas as it is to the encoder
+    void submit() {
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [&] { return queue.size() < MAX_QUEUED; });
+        queue.push_back(canvas);
+        changed.notify_all();
+    }
+
+    // writes the frames still queued
+    void close() {
+        if (!encoder.joinable())
+            return;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+            changed.notify_all();
+        }
+        encoder.join();
+        if (raw)
+            std::fclose(raw);
+        raw = nullptr;
+    }
+
+private:
+    // blue, cyan, green, yellow, red
+    static void order_color(double t, unsigned char* rgb) {
+        t = std::min(1.0, std::max(0.0, t)) * 4;
+        int band = std::min(3, (int)t);
+        int f = (int)std::lround((t-band)*255);
+        const int colors[5][3] = {{0, 0, 255}, {0, 255, 255}, {0, 255, 0},
+                                  {255, 255, 0}, {255, 0, 0}};
+        for (int i=0; i<3; i++) {
+            rgb[i] = (colors[band][i]*(255-f) + colors[band+1][i]*f) / 255;
+        }
+    }
+
+    // radius 0 is a single pixel, y goes up as in the GL programs
+    void disc(int x, int y, const unsigned char* rgb) {
+        for (int dy=-radius; dy<=radius; dy++) {
+            for (int dx=-radius; dx<=radius; dx++) {
+                if (dx*dx + dy*dy > radius*radius)
+                    continue;
+                int X = x+dx - minX, Y = height-1 - (y+dy - minY);
+                if ((unsigned)X >= (unsigned)width || (unsigned)Y >= (unsigned)height)
+                    continue;
+                unsigned char* pixel = &canvas[((size_t)Y*width + X)*3];
+                pixel[0] = rgb[0];
+                pixel[1] = rgb[1];
+                pixel[2] = rgb[2];
+            }
+        }
+    }
+
+    void encode() {
+        while (true) {
+            std::vector<unsigned char> frame;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                changed.wait(lock, [&] { return !queue.empty() || stopping; });
+                if (queue.empty())
+                    return;
+                frame.swap(queue.front());
+                queue.pop_front();
+                changed.notify_all();
+            }
+            if (!write(frame) && !failed) {
+                std::cerr << "Cannot write frame " << frames << " to " << path << "\n";
+                failed = true;
+            }
+            frames++;
+        }
+    }
+
+    bool write(const std::vector<unsigned char>& frame) {
+        if (raw)
+            return std::fwrite(frame.data(), 1, frame.size(), raw) == frame.size();
+        std::vector<char> name(path.size() + 32);
+        std::snprintf(name.data(), name.size(), path.c_str(), frames);
+        std::FILE* file = std::fopen(name.data(), "wb");
+        if (!file)
+            return false;
+        bool ok = write_png(file, frame);
+        return std::fclose(file) == 0 && ok;
+    }
+
+    static uint32_t crc32(uint32_t crc, const unsigned char* data, size_t n) {
+        static const std::vector<uint32_t> table = [] {
+            std::vector<uint32_t> t(256);
+            for (uint32_t i=0; i<256; i++) {
+                uint32_t c = i;
+                for (int k=0; k<8; k++) {
+                    c = (c & 1) ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+                }
+                t[i] = c;
+            }
+            return t;
+        }();
+        crc = ~crc;
+        for (size_t i=0; i<n; i++) {
+            crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+        }
+        return ~crc;
+    }
+
+    static void put32(std::vector<unsigned char>& out, uint32_t v) {
+        out.push_back(v >> 24);
+        out.push_back(v >> 16);
+        out.push_back(v >> 8);
+        out.push_back(v);
+    }
+
+    static bool chunk(std::FILE* file, const char* type, const std::vector<unsigned char>& data) {
+        std::vector<unsigned char> out;
+        put32(out, data.size());
+        out.insert(out.end(), type, type+4);
+        out.insert(out.end(), data.begin(), data.end());
+        put32(out, crc32(0, out.data()+4, out.size()-4));
+        return std::fwrite(out.data(), 1, out.size(), file) == out.size();
+    }
+
+    // 8 bit RGB, the image data in stored (uncompressed) deflate blocks:
+    // the frames are mostly black and compress well afterwards, the
+    // encoder only has to keep up with the simulation
+    bool write_png(std::FILE* file, const std::vector<unsigned char>& frame) const {
+        static const unsigned char SIGNATURE[8] = {137, 'P', 'N', 'G', '\r', '\n', 26, '\n'};
+        if (std::fwrite(SIGNATURE, 1, 8, file) != 8)
+            return false;
+        std::vector<unsigned char> header;
+        put32(header, width);
+        put32(header, height);
+        header.insert(header.end(), {8, 2, 0, 0, 0});
+
+        // rows with filter type 0 in front
+        size_t row = (size_t)width*3;
+        std::vector<unsigned char> rows((row+1)*height);
+        for (int y=0; y<height; y++) {
+            rows[y*(row+1)] = 0;
+            std::copy(&frame[y*row], &frame[y*row]+row, &rows[y*(row+1)+1]);
+        }
+        std::vector<unsigned char> data {0x78, 0x01};
+        uint32_t a(1), b(0);
+        for (size_t begin=0; begin<rows.size(); begin+=65535) {
+            size_t n = std::min<size_t>(65535, rows.size()-begin);
+            data.push_back(begin+n == rows.size()); // last block
+            data.push_back(n & 0xFF);
+            data.push_back(n >> 8);
+            data.push_back(~n & 0xFF);
+            data.push_back((~n >> 8) & 0xFF);
+            data.insert(data.end(), rows.begin()+begin, rows.begin()+begin+n);
+            for (size_t i=begin; i<begin+n; i++) {
+                a = (a + rows[i]) % 65521;
+                b = (b + a) % 65521;
+            }
+        }
+        put32(data, (b << 16) | a);
+        return chunk(file, "IHDR", header) && chunk(file, "IDAT", data)
+            && chunk(file, "IEND", std::vector<unsigned char>());
+    }
+
+    std::string path;
+    std::FILE* raw = nullptr;
+    int minX = 0, minY = 0, width = 0, height = 0;
+    std::vector<double> rotations; // cos and sin of each copy
+    int radius = 0;
+    long total = 1;
+    std::vector<unsigned char> canvas;
+
+    std::thread encoder;
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::deque<std::vector<unsigned char>> queue;
+    bool stopping = false;
+    int frames = 0;    // encoder thread only
+    bool failed = false;
+};
+
+#endif
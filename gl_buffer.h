@@ -0,0 +1,106 @@
+/* Vertex buffer for the fixed particles */
+
+#ifndef GL_BUFFER_H
+#define GL_BUFFER_H
+
+// needs GL_GLEXT_PROTOTYPES defined before the first GL include
+
+#include <GL/gl.h>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+// disc around the origin, precomputed once
+struct Disc {
+    std::vector<float> x, y;
+
+    void init(float radius, int sides) {
+        x.resize(sides);
+        y.resize(sides);
+        for (int i=0; i<sides; i++) {
+            x[i] = radius*std::cos(6.2831853*i/sides);
+            y[i] = radius*std::sin(6.2831853*i/sides);
+        }
+    }
+};
+
+// 2D vertices in a GL buffer object that only grows.
+// The cluster never changes once stuck, so each frame only the vertices
+// added since the last one are sent (upload), and a draw is a single
+// glDrawArrays however many particles there are. A copy is kept to fill
+// the buffer again when it has to grow.
+class VertexBuffer {
+public:
+    VertexBuffer() {}
+    VertexBuffer(const VertexBuffer&) = delete;
+    VertexBuffer& operator=(const VertexBuffer&) = delete;
+
+    // a new cluster
+    void clear() {
+        vertices.clear();
+        uploaded = 0;
+    }
+
+    size_t size() const {
+        return vertices.size()/2;
+    }
+
+    void add(float x, float y) {
+        vertices.push_back(x);
+        vertices.push_back(y);
+    }
+
+    // the disc as a fan of triangles
+    void add_disc(float x, float y, const Disc& disc) {
+        size_t n = disc.x.size();
+        for (size_t i=0; i<n; i++) {
+            size_t j = (i+1) % n;
+            add(x, y);
+            add(x + disc.x[i], y + disc.y[i]);
+            add(x + disc.x[j], y + disc.y[j]);
+        }
+    }
+
+    void upload() {
+        if (!buffer)
+            glGenBuffers(1, &buffer);
+        glBindBuffer(GL_ARRAY_BUFFER, buffer);
+        if (vertices.size() > capacity) {
+            capacity = std::max(2*capacity, vertices.size());
+            glBufferData(GL_ARRAY_BUFFER, capacity*sizeof(float), nullptr, GL_DYNAMIC_DRAW);
+            uploaded = 0;
+        }
+        if (vertices.size() > uploaded) {
+            glBufferSubData(GL_ARRAY_BUFFER, uploaded*sizeof(float),
+                            (vertices.size()-uploaded)*sizeof(float), vertices.data()+uploaded);
+            uploaded = vertices.size();
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    // with the current matrix and color
+    void draw(GLenum mode) const {
+        if (!buffer || !uploaded)
+            return;
+        glBindBuffer(GL_ARRAY_BUFFER, buffer);
+        glEnableClientState(GL_VERTEX_ARRAY);
+        glVertexPointer(2, GL_FLOAT, 0, nullptr);
+        glDrawArrays(mode, 0, uploaded/2);
+        glDisableClientState(GL_VERTEX_ARRAY);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+private:
+    GLuint buffer = 0;
+    size_t uploaded = 0, capacity = 0; // in floats
+    std::vector<float> vertices;
+};
+
+// one point per particle, appends particles [size(), count)
+template <class Particles> void add_points(VertexBuffer& buffer, const Particles& particles, size_t count) {
+    for (size_t i=buffer.size(); i<count; i++) {
+        buffer.add(particles[i].x, particles[i].y);
+    }
+}
+
+#endif
@@ -0,0 +1,53 @@
+/* Occupancy grid for the lattice variants */
+
+#ifndef OCCUPANCY_GRID_H
+#define OCCUPANCY_GRID_H
+
+#include <vector>
+#include <cmath>
+
+#include "sparse_lattice.h"
+
+// One byte per lattice site.
+// Instead of storing where the fixed particles are, each cell says whether
+// a fixed particle lies within the collision distance of it, so asking
+// "does this walker touch the cluster" is a single lookup.
+// The sites are a SparseLattice: the rectangle given to init is a plain
+// array, the cluster may grow past it without a bound and only the tiles
+// near it take memory.
+struct OccupancyGrid {
+    SparseLattice cells;
+    // lattice offsets (dx, dy) with dx*dx + dy*dy < collisionDistance^2
+    std::vector<int> offsetX, offsetY;
+
+    void init(int xMin, int yMin, int xMax, int yMax, float collisionDistance) {
+        cells.init(xMin, yMin, xMax, yMax);
+
+        offsetX.clear();
+        offsetY.clear();
+        int reach = (int)std::ceil(collisionDistance);
+        float distance2 = collisionDistance*collisionDistance;
+        for (int dy=-reach; dy<=reach; dy++) {
+            for (int dx=-reach; dx<=reach; dx++) {
+                if (dx*dx + dy*dy < distance2) {
+                    offsetX.push_back(dx);
+                    offsetY.push_back(dy);
+                }
+            }
+        }
+    }
+
+    // mark every site within the collision distance of (x, y)
+    void add(int x, int y) {
+        for (size_t i=0; i<offsetX.size(); i++) {
+            cells.at(x+offsetX[i], y+offsetY[i]) = 1;
+        }
+    }
+
+    // true if a fixed particle is within the collision distance of (x, y)
+    bool touches(int x, int y) const {
+        return cells.get(x, y);
+    }
+};
+
+#endif
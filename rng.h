@@ -0,0 +1,149 @@
+/* Random streams for the walkers */
+
+#ifndef RNG_H
+#define RNG_H
+
+#include <cstdint>
+
+inline uint64_t splitmix64(uint64_t& x) {
+    uint64_t z = (x += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+// Philox4x32-10 (Salmon et al., "Parallel random numbers: as easy as 1, 2, 3").
+// Counter based: draw n of stream s is a pure function of (seed, s, n), so
+// the streams never overlap and a state is just two integers.
+struct Philox {
+    uint64_t key;
+    uint32_t stream;
+    uint64_t counter;
+    uint64_t spare;
+    bool hasSpare;
+
+    void seed(uint64_t seed, uint64_t streamIndex) {
+        key = seed;
+        stream = (uint32_t)streamIndex;
+        counter = 0;
+        hasSpare = false;
+    }
+
+    static void mulhilo(uint32_t a, uint32_t b, uint32_t& hi, uint32_t& lo) {
+        uint64_t product = (uint64_t)a*b;
+        hi = (uint32_t)(product >> 32);
+        lo = (uint32_t)product;
+    }
+
+    uint64_t next() {
+        if (hasSpare) {
+            hasSpare = false;
+            return spare;
+        }
+        uint32_t c0 = (uint32_t)counter, c1 = (uint32_t)(counter >> 32);
+        uint32_t c2 = stream, c3 = 0;
+        uint32_t k0 = (uint32_t)key, k1 = (uint32_t)(key >> 32);
+        for (int round=0; round<10; round++) {
+            uint32_t hi0, lo0, hi1, lo1;
+            mulhilo(0xD2511F53u, c0, hi0, lo0);
+            mulhilo(0xCD9E8D57u, c2, hi1, lo1);
+            c0 = hi1 ^ c1 ^ k0;
+            c1 = lo1;
+            c2 = hi0 ^ c3 ^ k1;
+            c3 = lo0;
+            k0 += 0x9E3779B9u;
+            k1 += 0xBB67AE85u;
+        }
+        counter++;
+        spare = ((uint64_t)c3 << 32) | c2;
+        hasSpare = true;
+        return ((uint64_t)c1 << 32) | c0;
+    }
+};
+
+// xoshiro256** (Blackman and Vigna), faster but sequential: each stream is
+// seeded through splitmix64 from (seed, stream).
+struct Xoshiro {
+    uint64_t s[4];
+
+    void seed(uint64_t seed, uint64_t streamIndex) {
+        uint64_t x = seed ^ (streamIndex * 0xD1B54A32D192ED03ull);
+        for (int i=0; i<4; i++) {
+            s[i] = splitmix64(x);
+        }
+    }
+
+    static uint64_t rotl(uint64_t x, int k) {
+        return (x << k) | (x >> (64 - k));
+    }
+
+    uint64_t next() {
+        uint64_t result = rotl(s[1] * 5, 7) * 9;
+        uint64_t t = s[1] << 17;
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = rotl(s[3], 45);
+        return result;
+    }
+};
+
+// Hands out a 64 bit draw a few bits at a time: a lattice step takes two
+// bits, so one draw lasts 32 steps.
+template <class Generator>
+struct RandomBits {
+    Generator generator;
+    uint64_t bits;
+    int left;
+
+    void seed(uint64_t seed, uint64_t stream) {
+        generator.seed(seed, stream);
+        left = 0;
+    }
+
+    // the n (<= 32) lowest bits are random
+    unsigned take(int n) {
+        if (left < n) {
+            bits = generator.next();
+            left = 64;
+        }
+        unsigned result = bits & ((1ull << n) - 1);
+        bits >>= n;
+        left -= n;
+        return result;
+    }
+
+    bool bit() {
+        return take(1);
+    }
+
+    // true with probability exactly 1/3
+    bool one_in_three() {
+        unsigned r;
+        do {
+            r = take(2);
+        } while (r == 3);
+        return r == 0;
+    }
+
+    // in [0, n), from the next 32 bits of the draw (a new draw when fewer
+    // are left), uniform to within n/2^32
+    unsigned below(unsigned n) {
+        return ((uint64_t)take(32) * n) >> 32;
+    }
+
+    // uniform in [0, 1)
+    double uniform() {
+        return (generator.next() >> 11) * (1.0/9007199254740992.0);
+    }
+};
+
+#ifdef DLA_XOSHIRO
+typedef RandomBits<Xoshiro> Rng;
+#else
+typedef RandomBits<Philox> Rng;
+#endif
+
+#endif
@@ -0,0 +1,112 @@
+/* Simulation thread for the GL programs */
+
+#ifndef SIM_THREAD_H
+#define SIM_THREAD_H
+
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <cstdint>
+
+#include "dla_core.h"
+
+// Runs dla.run(iterations) over and over on its own thread, the GLUT
+// thread only draws, at its own rate.
+// After every tick the thread publishes the number of fixed particles
+// (release) and the renderer reads it (acquire) before reading the
+// particles below it. Those are never written again and never move, the
+// arena is reserved for maxParticle, so neither side ever waits.
+// With restart, a finished cluster is followed by a new one, as in
+// snowflake_2. The arena is then written over: the generation is bumped
+// before, and a renderer that sees it change while reading drops what it
+// read (as a seqlock).
+// The walker positions are published as well, x and y packed in 64 bits.
+template <class A>
+class SimulationThread {
+public:
+    SimulationThread(A& dla) : dla(dla) {}
+    SimulationThread(const SimulationThread&) = delete;
+    SimulationThread& operator=(const SimulationThread&) = delete;
+
+    ~SimulationThread() {
+        stop();
+    }
+
+    // dla.start() first
+    void start(int iterations, bool restart) {
+        walkers = std::vector<std::atomic<uint64_t>>(dla.settings.maxSimultaneous);
+        publish();
+        running = true;
+        thread = std::thread(&SimulationThread::loop, this, iterations, restart);
+    }
+
+    void stop() {
+        running = false;
+        if (thread.joinable())
+            thread.join();
+    }
+
+    size_t fixed() const {
+        return published.load(std::memory_order_acquire);
+    }
+
+    unsigned generation() const {
+        return generations.load(std::memory_order_acquire);
+    }
+
+    // true if the generation is still g after reading the particles
+    bool unchanged(unsigned g) const {
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return generations.load(std::memory_order_relaxed) == g;
+    }
+
+    bool finished() const {
+        return done.load(std::memory_order_acquire);
+    }
+
+    int walker_count() const {
+        return (int)walkers.size();
+    }
+
+    Particle walker(int i) const {
+        uint64_t xy = walkers[i].load(std::memory_order_relaxed);
+        return Particle {(int)(uint32_t)xy, (int)(uint32_t)(xy >> 32)};
+    }
+
+private:
+    void publish() {
+        for (size_t i=0; i<walkers.size(); i++) {
+            Particle p = dla.walker(i);
+            walkers[i].store((uint32_t)p.x | (uint64_t)(uint32_t)p.y << 32, std::memory_order_relaxed);
+        }
+        published.store(dla.fixedParticles.size(), std::memory_order_release);
+    }
+
+    void loop(int iterations, bool restart) {
+        while (running.load(std::memory_order_relaxed)) {
+            if (dla.finished()) {
+                if (!restart)
+                    break;
+                // a renderer that sees the new generation sees no particles,
+                // and one that read the new particles sees the generation
+                published.store(0, std::memory_order_relaxed);
+                generations.store(generations.load(std::memory_order_relaxed)+1,
+                                  std::memory_order_release);
+                std::atomic_thread_fence(std::memory_order_release);
+                dla.init_particles();
+            }
+            dla.run(iterations);
+            publish();
+        }
+        done.store(true, std::memory_order_release);
+    }
+
+    A& dla;
+    std::thread thread;
+    std::atomic<bool> running {false}, done {false};
+    std::atomic<size_t> published {0};
+    std::atomic<unsigned> generations {0};
+    std::vector<std::atomic<uint64_t>> walkers;
+};
+
+#endif
@@ -5,8 +5,13 @@
 */
 
 
+#ifndef HEADLESS
+#define GL_GLEXT_PROTOTYPES
 #include <GL/gl.h>
-#include <GL/glut.h>
+#include <GL/freeglut.h>
+#include "gl_buffer.h"
+#include "sim_thread.h"
+#endif
 
 #include <iostream>
 #include <cstdio>
@@ -15,6 +20,9 @@
 #include <random>
 #include <ctime>
 
+#include "dla_core.h"
+#include "dla_geometry.h"
+
 #define WIDTH 600
 #define HEIGHT 600
 #define FPS 50
@@ -27,145 +35,47 @@
 #define MAX_SIMULTANEOUS 1
 #define DOT_RADIUS 1
 #define OVERLAP_TOL 0 // in pixels
-#define COLLISION_DISTANCE DOT_RADIUS*2-OVERLAP_TOL
-
-
-struct Particle {
-    float x;
-    float y;
-    bool isFixed;
-    void update() {
-        //x -= 1;
-        x += (rand()%3) ? -1 : 1;
-        y += (rand()%2) ? -1 : 1;
-    }
-    double get_angle() {
-        double dst = std::sqrt(x*x+y*y);
-        return (y>0) ? std::acos(x / dst) : - std::acos(x / dst);
-    }
-    void border_control() {
-        if (get_angle()>PI/6) {
-            y--;
-        }
-        else if (get_angle()<-PI/6) {
-            y++;
-        }
-        if (x > WIDTH/2) {
-            x--;
-        }
-    }
-};
-
-
-bool is_collision(Particle* A, Particle* B);
-void init_particles ();
-void delete_particles();
-void add_new_particle();
-void check_collisions();
-void update_particles();
-void draw_particle(Particle* p);
-
-
-Particle** allParticles = new Particle* [MAX_PARTICLE];
-
-int currentTotalParticles(0); // current amount of particles in screen
-
-bool is_collision(Particle* A, Particle* B) {
-    double AxBx = std::abs(A->x - B->x);
-    double AyBy = std::abs(A->y - B->y);
-    if (AxBx > COLLISION_DISTANCE)
-        return false;
-    else if (AyBy > COLLISION_DISTANCE)
-        return false;
-    float dst(std::sqrt(AxBx*AxBx + AyBy*AyBy));
-    return dst < COLLISION_DISTANCE;
-}
-
-void init_particles () {
-    delete_particles();
-    allParticles[0] = new Particle {0, 0, true};
-    currentTotalParticles++;
-    for (int i=0; i<MAX_SIMULTANEOUS; i++) {
-        add_new_particle();
-    }
-}
-
-void delete_particles() {
-    for (int i=0; i<MAX_PARTICLE; i++) {
-        delete allParticles[i];
-        allParticles[i] = nullptr;
-    }
-}
-
-void add_new_particle() {
-    if (currentTotalParticles >= MAX_PARTICLE) {
-        return;
-    }
-    Particle* P = new Particle {WIDTH, 0, false};
-    allParticles[currentTotalParticles] = P;
-    currentTotalParticles++;
-}
 
-void check_collisions() {
-    // i for the free and j for the fixed
-    for (int i=0; i<currentTotalParticles; i++) {
-        if (allParticles[i]->isFixed == true)
-            continue;
-        for (int j=0; j<currentTotalParticles; j++) {
-            if (allParticles[j]->isFixed == false)
-                continue;
-            if (is_collision(allParticles[i], allParticles[j])) {
-                allParticles[i]->isFixed = true;
-                add_new_particle();
-                break;
-            }
+Aggregation<Wedge> dla({WIDTH, HEIGHT, MAX_PARTICLE, MAX_SIMULTANEOUS,
+                        DOT_RADIUS, OVERLAP_TOL, 0, FPS});
+
+#ifndef HEADLESS
+
+// the wedge holds the fixed particles once, it is drawn rotated by 0, 120
+// and 240 degrees, then flipped around the y axis
+Disc disc;
+VertexBuffer wedge;
+size_t drawnParticles(0); // fixed particles already in the wedge buffer
+unsigned drawnGeneration(0);
+
+// a new snowflake is started as soon as one is done
+SimulationThread<Aggregation<Wedge>> simulation(dla);
+
+template <class Draw> void each_copy(Draw draw) {
+    for (int flip=0; flip<2; flip++) {
+        for (int rot=0; rot<360; rot+=120) {
+            glPushMatrix();
+            glRotatef(rot, 0, 0, 1);
+            if (flip)
+                glRotatef(180, 0, 1, 0);
+            draw();
+            glPopMatrix();
         }
     }
 }
 
-void update_particles() {
-    for (int i=0; i<currentTotalParticles; i++) {
-        if (allParticles[i]->isFixed)
-            continue;
-        allParticles[i]->update();
-        allParticles[i]->border_control();
-    }
-}
-
-void draw_particle(Particle* p) {
-    glColor3f(1.0, 1.0, 1.0);
-    //float dist = std::sqrt(p->x*p->x + p->y*p->y);
-    
-    for (int rot=0; rot<360; rot+=120) {
-        glPushMatrix();
-        glRotatef(rot, 0, 0, 1);
-        glBegin(GL_POLYGON);
-        for (float i=0; i<TWO_PI; i+=TWO_PI/10) {
-            glVertex2f(p->x + std::cos(i)*DOT_RADIUS,
-                       p->y + std::sin(i)*DOT_RADIUS);
-        }
-        glEnd();
-        glPopMatrix();
-    }
-    for (int rot=0; rot<360; rot+=120) {
-        glPushMatrix();
-        glRotatef(rot, 0, 0, 1);
-        glRotatef(180, 0, 1, 0);
-        
-        glBegin(GL_POLYGON);
-        for (float i=0; i<TWO_PI; i+=TWO_PI/10) {
-            glVertex2f(p->x + std::cos(i)*DOT_RADIUS,
-                       p->y + std::sin(i)*DOT_RADIUS);
-        }
-        glEnd();
-        glPopMatrix();
+void draw_particle(const Particle& p) {
+    glBegin(GL_POLYGON);
+    for (size_t i=0; i<disc.x.size(); i++) {
+        glVertex2f(p.x + disc.x[i], p.y + disc.y[i]);
     }
+    glEnd();
     /*
     glColor3f(0.2, 0.2, 0.2);
     for (float x=PI/6; x<TWO_PI; x+=PI3) {
         glBegin(GL_LINE_STRIP);
           glVertex2f(0, 0);
-          glVertex2f(WIDTH*std::cos(x), HEIGHT*std::sin(x));
+          glVertex2f(dla.settings.width*std::cos(x), dla.settings.height*std::sin(x));
         glEnd();
     }*/
 }
@@ -173,8 +83,11 @@ void draw_particle(Particle* p) {
 
 void init() {
     glClearColor(0.1, 0.1, 0.1, 1.0);
-    std::srand(std::time(0));
-    init_particles();
+    disc.init(dla.settings.dotRadius, 10);
+    if (!dla.start())
+        std::exit(1);
+    std::cout << "Seed " << dla.seed << "\n";
+    simulation.start(1000, true);
 }
 
 int theta(0);
@@ -182,10 +95,30 @@ void display_callback() {
     glClear (GL_COLOR_BUFFER_BIT);
     //glRotatef(theta, 0.0, 0.0, 1.0);
     theta+=PI4/2; // in radians
-    glColor3f(1.0, 1.0, 0.5);
-    for (int i=0; i<currentTotalParticles; i++) {
-        draw_particle(allParticles[i]);
+    unsigned generation = simulation.generation();
+    if (generation != drawnGeneration) {
+        wedge.clear();
+        drawnParticles = 0;
+        drawnGeneration = generation;
+    }
+    size_t fixed = simulation.fixed();
+    for (; drawnParticles<fixed; drawnParticles++) {
+        const Particle& p = dla.fixedParticles[drawnParticles];
+        wedge.add_disc(p.x, p.y, disc);
     }
+    // the snowflake was started again while reading, try next frame
+    if (!simulation.unchanged(generation)) {
+        wedge.clear();
+        drawnParticles = 0;
+    }
+    wedge.upload();
+    glColor3f(1.0, 1.0, 1.0);
+    each_copy([] {
+        wedge.draw(GL_TRIANGLES);
+        for (int i=0; i<simulation.walker_count(); i++) {
+            draw_particle(simulation.walker(i));
+        }
+    });
 
     glFlush();
     glutSwapBuffers();
@@ -196,42 +129,45 @@ void reshape_callback(int width, int height) {
     glMatrixMode(GL_PROJECTION);
     glLoadIdentity();
     int margin(0);
-    glOrtho(-WIDTH/2-margin, WIDTH/2+margin,
-            -HEIGHT/2-margin, HEIGHT/2+margin,
+    glOrtho(-dla.settings.width/2-margin, dla.settings.width/2+margin,
+            -dla.settings.height/2-margin, dla.settings.height/2+margin,
             -1.0, 0.0);
     glMatrixMode(GL_MODELVIEW);
 }
 
+// the simulation runs on its own thread, this only refreshes the window
 void timer_callback(int) {
-    auto start(std::chrono::steady_clock::now());
-    if (currentTotalParticles >= MAX_PARTICLE) {
-        currentTotalParticles = 0;
-        init_particles();
-    }
-    //while(currentTotalParticles < MAX_PARTICLE) {
-    for (int i=0; i<1000; i++) {
-        check_collisions();
-        update_particles();
-    }
     glutPostRedisplay(); // run the display_callback function
-
-    auto stop(std::chrono::steady_clock::now());
-    auto duration(std::chrono::duration_cast<std::chrono::milliseconds>(stop-start));
-    glutTimerFunc(std::abs(1000.0/FPS - duration.count()), timer_callback, 0);
+    glutTimerFunc(1000/dla.settings.fps, timer_callback, 0);
 }
 
 
 int main(int argc, char **argv) {
     glutInit(&argc, argv); // initialize
+    parse_options(argc, argv, dla);
     glutInitDisplayMode(GLUT_RGB | GLUT_DOUBLE);
     glutInitWindowPosition(15, 15); // optional
-    glutInitWindowSize(WIDTH, HEIGHT);
+    glutInitWindowSize(dla.settings.width, dla.settings.height);
     glutCreateWindow("Brownian Snowflake");
+    // closing the window returns from glutMainLoop rather than exiting
+    glutSetOption(GLUT_ACTION_ON_WINDOW_CLOSE, GLUT_ACTION_GLUTMAINLOOP_RETURNS);
     glutDisplayFunc(display_callback);
     glutReshapeFunc(reshape_callback);
-    glutTimerFunc(1000/FPS, timer_callback, 0);
+    glutTimerFunc(1000/dla.settings.fps, timer_callback, 0);
     init();
     glutMainLoop();
+    // the encoder is joined before the statics it uses are destroyed
+    simulation.stop();
+    dla.finish();
 
     return 0;
 }
+
+#else
+
+// headless build: g++ -O2 -DHEADLESS snowflake_2.cpp
+int main(int argc, char **argv) {
+    return run_headless(dla, 1000, argc, argv, "snowflake_2.txt");
+}
+
+#endif
@@ -0,0 +1,135 @@
+/* Unbounded lattice of bytes stored in tiles */
+
+#ifndef SPARSE_LATTICE_H
+#define SPARSE_LATTICE_H
+
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+#include "arena.h"
+
+// A lattice of bytes with no bounds.
+// The rectangle given to init is a plain array, as the lattice used to be,
+// so the walks inside the window pay one test more than before. Past it the
+// sites are in tiles of 64x64, each taken from a pool the first time one of
+// its sites is written and found through a directory of tile numbers over
+// the rectangle of tiles written so far, which grows (doubling) as the
+// cluster does. Tile 0 is all zeros and stands for every tile never
+// written, so a read there is two lookups with no test on the tile.
+// Memory past the window follows the footprint of the cluster: 4 KB per
+// tile it touches, plus 4 bytes of directory per 4096 sites of its
+// bounding rectangle.
+class SparseLattice {
+public:
+    static const int TILE_BITS = 6;
+    static const int TILE = 1 << TILE_BITS;
+
+    SparseLattice() {}
+    SparseLattice(const SparseLattice&) = delete;
+    SparseLattice& operator=(const SparseLattice&) = delete;
+
+    // empty, [xMin, xMax] x [yMin, yMax] is the window
+    void init(int xMin, int yMin, int xMax, int yMax) {
+        minX = xMin;
+        minY = yMin;
+        width = xMax - xMin + 1;
+        height = yMax - yMin + 1;
+        window.assign((size_t)width*height, 0);
+        originX = xMin >> TILE_BITS;
+        originY = yMin >> TILE_BITS;
+        tilesX = (xMax >> TILE_BITS) - originX + 1;
+        tilesY = (yMax >> TILE_BITS) - originY + 1;
+        directory.assign((size_t)tilesX*tilesY, 0);
+        tiles.clear();
+        new_tile();
+    }
+
+    unsigned char get(int x, int y) const {
+        if (inside(x, y))
+            return window[(size_t)(y-minY)*width + (x-minX)];
+        unsigned tx = (x >> TILE_BITS) - originX, ty = (y >> TILE_BITS) - originY;
+        if (tx >= (unsigned)tilesX || ty >= (unsigned)tilesY)
+            return 0;
+        return tiles[directory[(size_t)ty*tilesX + tx]].cells[site(x, y)];
+    }
+
+    // the site, its tile is allocated if needed
+    unsigned char& at(int x, int y) {
+        if (inside(x, y))
+            return window[(size_t)(y-minY)*width + (x-minX)];
+        int tx = x >> TILE_BITS, ty = y >> TILE_BITS;
+        cover(tx, ty);
+        uint32_t& tile = directory[(size_t)(ty-originY)*tilesX + (tx-originX)];
+        if (!tile)
+            tile = new_tile();
+        return tiles[tile].cells[site(x, y)];
+    }
+
+    // tiles in use past the window, the empty one included
+    size_t tile_count() const {
+        return tiles.size();
+    }
+
+    size_t bytes() const {
+        return window.size() + tiles.size()*sizeof(Tile) + directory.size()*sizeof(uint32_t);
+    }
+
+private:
+    struct Tile {
+        unsigned char cells[TILE*TILE] = {};
+    };
+
+    bool inside(int x, int y) const {
+        return (unsigned)(x-minX) < (unsigned)width && (unsigned)(y-minY) < (unsigned)height;
+    }
+
+    static int site(int x, int y) {
+        return ((y & (TILE-1)) << TILE_BITS) | (x & (TILE-1));
+    }
+
+    uint32_t new_tile() {
+        tiles.push_back(Tile());
+        return (uint32_t)tiles.size()-1;
+    }
+
+    // grows the directory to hold tile (tx, ty), at least doubling the
+    // side it grows on
+    void cover(int tx, int ty) {
+        if ((unsigned)(tx-originX) < (unsigned)tilesX && (unsigned)(ty-originY) < (unsigned)tilesY)
+            return;
+        int newMinX(originX), newMinY(originY);
+        int newMaxX(originX+tilesX-1), newMaxY(originY+tilesY-1);
+        if (tx < newMinX)
+            newMinX = std::min(tx, newMinX - tilesX);
+        if (tx > newMaxX)
+            newMaxX = std::max(tx, newMaxX + tilesX);
+        if (ty < newMinY)
+            newMinY = std::min(ty, newMinY - tilesY);
+        if (ty > newMaxY)
+            newMaxY = std::max(ty, newMaxY + tilesY);
+        int newWidth(newMaxX-newMinX+1), newHeight(newMaxY-newMinY+1);
+        std::vector<uint32_t> grown((size_t)newWidth*newHeight, 0);
+        for (int j=0; j<tilesY; j++) {
+            std::copy(&directory[(size_t)j*tilesX], &directory[(size_t)j*tilesX] + tilesX,
+                      &grown[(size_t)(j+originY-newMinY)*newWidth + (originX-newMinX)]);
+        }
+        directory.swap(grown);
+        originX = newMinX;
+        originY = newMinY;
+        tilesX = newWidth;
+        tilesY = newHeight;
+    }
+
+    int minX = 0, minY = 0;
+    int width = 0, height = 0;
+    std::vector<unsigned char> window;
+
+    // directory of the tiles from (originX, originY), tilesX x tilesY
+    int originX = 0, originY = 0;
+    int tilesX = 0, tilesY = 0;
+    std::vector<uint32_t> directory;
+    Arena<Tile> tiles; // tiles[0] stays empty
+};
+
+#endif
@@ -0,0 +1,80 @@
+/* Hot path counters and timers, compiled in with -DDLA_STATS */
+
+#ifndef STATS_H
+#define STATS_H
+
+#include <cstdint>
+#include <chrono>
+#include <iostream>
+
+// STATS_ONLY(code) is code with -DDLA_STATS and nothing otherwise, so the
+// counters cost nothing in a normal build.
+#ifdef DLA_STATS
+#define STATS_ONLY(code) code
+#else
+#define STATS_ONLY(code)
+#endif
+
+// what a thread counts while it steps its walkers, added up once an epoch
+struct StepCounters {
+    uint64_t rejected = 0; // walkers outside the band, no collision test
+    uint64_t jumps = 0;    // --hop jumps
+    uint64_t killed = 0;   // walkers respawned by the geometry on the way
+
+    void add(const StepCounters& other) {
+        rejected += other.rejected;
+        jumps += other.jumps;
+        killed += other.killed;
+    }
+};
+
+struct Stats {
+    uint64_t ticks = 0;
+    uint64_t sticks = 0;
+    uint64_t steps = 0;
+    uint64_t tests = 0;    // collision tests (grid lookups, or pairs)
+    StepCounters step;
+    // wall time in ns
+    uint64_t stepTime = 0;       // walkers stepping
+    uint64_t commitTime = 0;     // stuck walkers added to the cluster
+
+    void add(const Stats& other) {
+        ticks += other.ticks;
+        sticks += other.sticks;
+        steps += other.steps;
+        tests += other.tests;
+        step.add(other.step);
+        stepTime += other.stepTime;
+        commitTime += other.commitTime;
+    }
+
+    // one line, the rates are per tick
+    void print(std::ostream& out, const char* label) const {
+        double t = ticks ? ticks : 1;
+        out << label << ": " << ticks << " ticks"
+            << ", sticks/tick " << sticks/t
+            << ", steps/tick " << steps/t
+            << ", tests/tick " << tests/t
+            << ", band rejections/tick " << step.rejected/t
+            << ", respawns/tick " << step.killed/t
+            << ", jumps/tick " << step.jumps/t
+            << ", ms in step " << stepTime*1e-6
+            << ", commit " << commitTime*1e-6 << "\n";
+    }
+};
+
+// adds the time spent in a scope to a counter
+class ScopedTimer {
+public:
+    ScopedTimer(uint64_t& total) : total(total), start(std::chrono::steady_clock::now()) {}
+    ~ScopedTimer() {
+        auto stop(std::chrono::steady_clock::now());
+        total += std::chrono::duration_cast<std::chrono::nanoseconds>(stop-start).count();
+    }
+
+private:
+    uint64_t& total;
+    std::chrono::steady_clock::time_point start;
+};
+
+#endif
@@ -0,0 +1,130 @@
+/* Shared memory between the strip processes of dla_strips.cpp */
+
+#ifndef STRIP_EXCHANGE_H
+#define STRIP_EXCHANGE_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+#include <sys/mman.h>
+
+// what a strip hands to a neighbour
+struct StripMessage {
+    enum Kind { WALKER, GHOST };
+    int kind;
+    int x, y; // the walker that crossed, or the particle that stuck
+};
+
+// Messages from one strip to one neighbour, in memory shared by the two
+// processes: one producer, one consumer, no lock and no system call.
+// The producer only writes head and the consumer only writes tail, each on
+// its own cache line, so a message costs a release store on each side.
+// Zeroed memory is an empty ring.
+struct StripRing {
+    static const uint32_t SIZE = 4096; // a power of two
+
+    alignas(64) std::atomic<uint32_t> head;
+    alignas(64) std::atomic<uint32_t> tail;
+    StripMessage slots[SIZE];
+
+    // false if the ring is full
+    bool push(const StripMessage& m) {
+        uint32_t h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) == SIZE)
+            return false;
+        slots[h & (SIZE-1)] = m;
+        head.store(h+1, std::memory_order_release);
+        return true;
+    }
+
+    // false if the ring is empty
+    bool pop(StripMessage& m) {
+        uint32_t t = tail.load(std::memory_order_relaxed);
+        if (t == head.load(std::memory_order_acquire))
+            return false;
+        m = slots[t & (SIZE-1)];
+        tail.store(t+1, std::memory_order_release);
+        return true;
+    }
+};
+
+static_assert(ATOMIC_INT_LOCK_FREE == 2, "the rings need lock free atomics to be shared between processes");
+
+// a particle as it stuck, order is its rank over every strip
+struct StuckParticle {
+    int x, y;
+    uint32_t order;
+};
+
+// One anonymous shared mapping made before the fork, so every strip
+// process sees it at the same address:
+//   the header, shared by all strips
+//   per strip, its two outgoing rings and its counters
+//   per strip, the particles that stuck in it
+// Each part starts on a page of its own. The mapping is not reserved: a
+// page is only backed once touched, and the process that touches it first
+// is the strip that owns it, so with the default first touch policy its
+// pages stay on the node it runs on.
+class StripMemory {
+public:
+    struct Header {
+        std::atomic<uint32_t> claimed; // orders handed out so far
+        std::atomic<int> highest;      // top of the cluster over every strip
+    };
+
+    struct Strip {
+        StripRing toLeft, toRight;
+        // written by the strip, read by the launcher once it exited
+        uint32_t fixed;
+        uint64_t steps, handoffs, ghosts;
+    };
+
+    StripMemory() {}
+    StripMemory(const StripMemory&) = delete;
+    StripMemory& operator=(const StripMemory&) = delete;
+
+    ~StripMemory() {
+        if (base)
+            munmap(base, size);
+    }
+
+    // room for capacity particles in each strip
+    bool create(int strips, uint32_t capacity) {
+        count = strips;
+        stripBytes = round_up(sizeof(Strip));
+        particleBytes = round_up((size_t)capacity*sizeof(StuckParticle));
+        size = round_up(sizeof(Header)) + count*(stripBytes + particleBytes);
+        void* mapped = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                            MAP_SHARED | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (mapped == MAP_FAILED)
+            return false;
+        base = (char*)mapped;
+        return true;
+    }
+
+    Header& header() {
+        return *(Header*)base;
+    }
+
+    Strip& strip(int i) {
+        return *(Strip*)(base + round_up(sizeof(Header)) + i*stripBytes);
+    }
+
+    StuckParticle* particles(int i) {
+        return (StuckParticle*)(base + round_up(sizeof(Header)) + count*stripBytes + i*particleBytes);
+    }
+
+private:
+    static size_t round_up(size_t bytes) {
+        const size_t PAGE = 4096;
+        return (bytes + PAGE-1) / PAGE * PAGE;
+    }
+
+    char* base = nullptr;
+    size_t size = 0;
+    int count = 0;
+    size_t stripBytes = 0, particleBytes = 0;
+};
+
+#endif
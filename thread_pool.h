@@ -0,0 +1,84 @@
+/* Fork-join pool used to step the walkers on several cores */
+
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <vector>
+
+// run(fn) calls fn(0) .. fn(size()-1) in parallel and returns when all
+// of them are done, fn(0) runs on the calling thread.
+// The threads are kept between calls and sleep in between.
+class ThreadPool {
+public:
+    ThreadPool(int n) : total(n) {
+        for (int i=1; i<n; i++) {
+            workers.emplace_back(&ThreadPool::work, this, i);
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread& t : workers) {
+            t.join();
+        }
+    }
+
+    int size() const {
+        return total;
+    }
+
+    void run(const std::function<void(int)>& fn) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            task = &fn;
+            pending = total-1;
+            generation++;
+        }
+        wake.notify_all();
+        fn(0);
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [this] { return pending == 0; });
+        task = nullptr;
+    }
+
+private:
+    void work(int index) {
+        unsigned long seen(0);
+        while (true) {
+            const std::function<void(int)>* fn;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [&] { return stopping || generation != seen; });
+                if (stopping)
+                    return;
+                seen = generation;
+                fn = task;
+            }
+            (*fn)(index);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                pending--;
+            }
+            done.notify_one();
+        }
+    }
+
+    int total;
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake, done;
+    const std::function<void(int)>* task = nullptr;
+    unsigned long generation = 0;
+    int pending = 0;
+    bool stopping = false;
+};
+
+#endif
@@ -0,0 +1,141 @@
+/* Bit-packed occupancy of a cubic lattice, for DLA_3d.cpp */
+
+#ifndef VOXEL_GRID_H
+#define VOXEL_GRID_H
+
+#include <vector>
+#include <cmath>
+#include <cstdint>
+
+// The 3D OccupancyGrid: one bit per site of the cube [min, min+side)^3,
+// set when a fixed particle lies within the collision distance of the site,
+// so the sticking test is a single bit lookup.
+// Sites outside the cube are never sticky.
+struct VoxelGrid {
+    int min, side;
+    std::vector<uint64_t> bits;
+    // lattice offsets within the collision distance
+    std::vector<int> offsetX, offsetY, offsetZ;
+
+    void init(int cubeMin, int cubeSide, float collisionDistance) {
+        min = cubeMin;
+        side = cubeSide;
+        bits.assign(((size_t)side*side*side + 63) / 64, 0);
+
+        offsetX.clear();
+        offsetY.clear();
+        offsetZ.clear();
+        int reach = (int)std::ceil(collisionDistance);
+        float distance2 = collisionDistance*collisionDistance;
+        for (int dz=-reach; dz<=reach; dz++) {
+            for (int dy=-reach; dy<=reach; dy++) {
+                for (int dx=-reach; dx<=reach; dx++) {
+                    if (dx*dx + dy*dy + dz*dz < distance2) {
+                        offsetX.push_back(dx);
+                        offsetY.push_back(dy);
+                        offsetZ.push_back(dz);
+                    }
+                }
+            }
+        }
+    }
+
+    bool inside(int x, int y, int z) const {
+        return (unsigned)(x-min) < (unsigned)side && (unsigned)(y-min) < (unsigned)side &&
+               (unsigned)(z-min) < (unsigned)side;
+    }
+
+    size_t site(int x, int y, int z) const {
+        return ((size_t)(z-min)*side + (y-min))*side + (x-min);
+    }
+
+    void add(int x, int y, int z) {
+        for (size_t i=0; i<offsetX.size(); i++) {
+            int X(x+offsetX[i]), Y(y+offsetY[i]), Z(z+offsetZ[i]);
+            if (inside(X, Y, Z)) {
+                size_t s = site(X, Y, Z);
+                bits[s >> 6] |= (uint64_t)1 << (s & 63);
+            }
+        }
+    }
+
+    bool touches(int x, int y, int z) const {
+        if (!inside(x, y, z))
+            return false;
+        size_t s = site(x, y, z);
+        return (bits[s >> 6] >> (s & 63)) & 1;
+    }
+};
+
+// The 3D DistancePyramid: level k (k >= 1) has one bit per block of 2^k
+// sites a side, set if it holds a fixed particle. If the block of a point
+// and its 26 neighbours are empty, every fixed particle is at least 2^k
+// away. All the levels together take 1/7 of a bit per site.
+struct VoxelPyramid {
+    int min;
+    int levels;
+    std::vector<int> sides;
+    std::vector<std::vector<uint64_t>> blocks; // blocks[0] is level 1
+
+    void init(int cubeMin, int cubeSide) {
+        min = cubeMin;
+        sides.clear();
+        blocks.clear();
+        levels = 0;
+        int size(1);
+        do {
+            size *= 2;
+            levels++;
+            int n = (cubeSide + size - 1) / size;
+            sides.push_back(n);
+            blocks.emplace_back(((size_t)n*n*n + 63) / 64, 0);
+        } while (size < cubeSide);
+    }
+
+    bool marked(int k, int bx, int by, int bz) const {
+        int n = sides[k];
+        if ((unsigned)bx >= (unsigned)n || (unsigned)by >= (unsigned)n || (unsigned)bz >= (unsigned)n)
+            return false;
+        size_t b = ((size_t)bz*n + by)*n + bx;
+        return (blocks[k][b >> 6] >> (b & 63)) & 1;
+    }
+
+    void add(int x, int y, int z) {
+        unsigned X(x-min), Y(y-min), Z(z-min);
+        for (int k=0; k<levels; k++) {
+            unsigned bx(X >> (k+1)), by(Y >> (k+1)), bz(Z >> (k+1));
+            unsigned n = sides[k];
+            if (bx >= n || by >= n || bz >= n)
+                return;
+            size_t b = ((size_t)bz*n + by)*n + bx;
+            blocks[k][b >> 6] |= (uint64_t)1 << (b & 63);
+        }
+    }
+
+    bool empty_around(int k, int bx, int by, int bz) const {
+        for (int l=bz-1; l<=bz+1; l++) {
+            for (int j=by-1; j<=by+1; j++) {
+                for (int i=bx-1; i<=bx+1; i++) {
+                    if (marked(k, i, j, l))
+                        return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    // every fixed particle is at least this far from (x, y, z), 0 if it
+    // is closer than 2^firstLevel
+    float distance_bound(int x, int y, int z, int firstLevel = 1) const {
+        int X(x-min), Y(y-min), Z(z-min);
+        float bound(0);
+        for (int k=firstLevel-1; k<levels; k++) {
+            if (!empty_around(k, X >> (k+1), Y >> (k+1), Z >> (k+1)))
+                break;
+            bound = 2 << k;
+        }
+        return bound;
+    }
+};
+
+#endif
@@ -0,0 +1,225 @@
+/* Vector kernels over the walker arrays */
+
+#ifndef WALKER_KERNELS_H
+#define WALKER_KERNELS_H
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define DLA_X86
+#endif
+
+// Which walkers are in the band where something can happen.
+// INSIDE:  x*x + y*y <= limit
+// OUTSIDE: x*x + y*y >= limit
+// BELOW:   y <= limit
+// ALL:     every walker
+enum BandMode {BAND_ALL, BAND_INSIDE, BAND_OUTSIDE, BAND_BELOW};
+
+struct Band {
+    BandMode mode;
+    float limit;
+};
+
+// The walkers are stored as separate x and y arrays. Their next 32 steps
+// are in xBits/yBits (lowest bit first, 1 for +1), the masks hold 0 or -1.
+struct WalkerKernels {
+    const char* name;
+    // x += +-1, y += +-1 where mask is set, the bits are consumed anyway
+    void (*step)(int* x, int* y, uint32_t* xBits, uint32_t* yBits,
+                 const int* mask, int n);
+    // clamp to [lo, hi]
+    void (*clamp)(int* v, int n, int lo, int hi);
+    // mask = -1 for the walkers in the band, 0 for the others
+    void (*band)(const int* x, const int* y, int n, Band band, int* mask);
+};
+
+inline void step_scalar(int* x, int* y, uint32_t* xBits, uint32_t* yBits,
+                        const int* mask, int n) {
+    for (int i=0; i<n; i++) {
+        x[i] += (((int)(xBits[i] & 1) << 1) - 1) & mask[i];
+        y[i] += (((int)(yBits[i] & 1) << 1) - 1) & mask[i];
+        xBits[i] >>= 1;
+        yBits[i] >>= 1;
+    }
+}
+
+inline void clamp_scalar(int* v, int n, int lo, int hi) {
+    for (int i=0; i<n; i++) {
+        v[i] = std::min(std::max(v[i], lo), hi);
+    }
+}
+
+inline bool in_band(int x, int y, Band band) {
+    switch (band.mode) {
+    case BAND_INSIDE:
+        return (float)x*x + (float)y*y <= band.limit;
+    case BAND_OUTSIDE:
+        return (float)x*x + (float)y*y >= band.limit;
+    case BAND_BELOW:
+        return y <= band.limit;
+    default:
+        return true;
+    }
+}
+
+inline void band_scalar(const int* x, const int* y, int n, Band band, int* mask) {
+    for (int i=0; i<n; i++) {
+        mask[i] = in_band(x[i], y[i], band) ? -1 : 0;
+    }
+}
+
+#ifdef DLA_X86
+
+__attribute__((target("avx2")))
+inline void step_avx2(int* x, int* y, uint32_t* xBits, uint32_t* yBits,
+                      const int* mask, int n) {
+    const __m256i one = _mm256_set1_epi32(1);
+    int i(0);
+    for (; i+8<=n; i+=8) {
+        __m256i m = _mm256_loadu_si256((const __m256i*)(mask+i));
+        __m256i bx = _mm256_loadu_si256((const __m256i*)(xBits+i));
+        __m256i by = _mm256_loadu_si256((const __m256i*)(yBits+i));
+        __m256i dx = _mm256_sub_epi32(_mm256_slli_epi32(_mm256_and_si256(bx, one), 1), one);
+        __m256i dy = _mm256_sub_epi32(_mm256_slli_epi32(_mm256_and_si256(by, one), 1), one);
+        __m256i X = _mm256_loadu_si256((const __m256i*)(x+i));
+        __m256i Y = _mm256_loadu_si256((const __m256i*)(y+i));
+        _mm256_storeu_si256((__m256i*)(x+i), _mm256_add_epi32(X, _mm256_and_si256(dx, m)));
+        _mm256_storeu_si256((__m256i*)(y+i), _mm256_add_epi32(Y, _mm256_and_si256(dy, m)));
+        _mm256_storeu_si256((__m256i*)(xBits+i), _mm256_srli_epi32(bx, 1));
+        _mm256_storeu_si256((__m256i*)(yBits+i), _mm256_srli_epi32(by, 1));
+    }
+    step_scalar(x+i, y+i, xBits+i, yBits+i, mask+i, n-i);
+}
+
+__attribute__((target("avx2")))
+inline void clamp_avx2(int* v, int n, int lo, int hi) {
+    const __m256i LO = _mm256_set1_epi32(lo), HI = _mm256_set1_epi32(hi);
+    int i(0);
+    for (; i+8<=n; i+=8) {
+        __m256i V = _mm256_loadu_si256((const __m256i*)(v+i));
+        V = _mm256_min_epi32(_mm256_max_epi32(V, LO), HI);
+        _mm256_storeu_si256((__m256i*)(v+i), V);
+    }
+    clamp_scalar(v+i, n-i, lo, hi);
+}
+
+__attribute__((target("avx2")))
+inline void band_avx2(const int* x, const int* y, int n, Band band, int* mask) {
+    if (band.mode == BAND_ALL) {
+        std::fill(mask, mask+n, -1);
+        return;
+    }
+    const __m256 limit = _mm256_set1_ps(band.limit);
+    int i(0);
+    for (; i+8<=n; i+=8) {
+        __m256 X = _mm256_cvtepi32_ps(_mm256_loadu_si256((const __m256i*)(x+i)));
+        __m256 Y = _mm256_cvtepi32_ps(_mm256_loadu_si256((const __m256i*)(y+i)));
+        __m256 inside;
+        if (band.mode == BAND_BELOW) {
+            inside = _mm256_cmp_ps(Y, limit, _CMP_LE_OQ);
+        }
+        else {
+            __m256 r2 = _mm256_add_ps(_mm256_mul_ps(X, X), _mm256_mul_ps(Y, Y));
+            inside = band.mode == BAND_INSIDE ? _mm256_cmp_ps(r2, limit, _CMP_LE_OQ)
+                                              : _mm256_cmp_ps(r2, limit, _CMP_GE_OQ);
+        }
+        _mm256_storeu_si256((__m256i*)(mask+i), _mm256_castps_si256(inside));
+    }
+    band_scalar(x+i, y+i, n-i, band, mask+i);
+}
+
+// gcc 12 warns about the _mm512_undefined inside its own intrinsics
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+
+__attribute__((target("avx512f")))
+inline void step_avx512(int* x, int* y, uint32_t* xBits, uint32_t* yBits,
+                        const int* mask, int n) {
+    const __m512i one = _mm512_set1_epi32(1);
+    int i(0);
+    for (; i+16<=n; i+=16) {
+        __m512i m = _mm512_loadu_si512(mask+i);
+        __m512i bx = _mm512_loadu_si512(xBits+i);
+        __m512i by = _mm512_loadu_si512(yBits+i);
+        __m512i dx = _mm512_sub_epi32(_mm512_slli_epi32(_mm512_and_si512(bx, one), 1), one);
+        __m512i dy = _mm512_sub_epi32(_mm512_slli_epi32(_mm512_and_si512(by, one), 1), one);
+        __m512i X = _mm512_loadu_si512(x+i);
+        __m512i Y = _mm512_loadu_si512(y+i);
+        _mm512_storeu_si512(x+i, _mm512_add_epi32(X, _mm512_and_si512(dx, m)));
+        _mm512_storeu_si512(y+i, _mm512_add_epi32(Y, _mm512_and_si512(dy, m)));
+        _mm512_storeu_si512(xBits+i, _mm512_srli_epi32(bx, 1));
+        _mm512_storeu_si512(yBits+i, _mm512_srli_epi32(by, 1));
+    }
+    step_scalar(x+i, y+i, xBits+i, yBits+i, mask+i, n-i);
+}
+
+__attribute__((target("avx512f")))
+inline void clamp_avx512(int* v, int n, int lo, int hi) {
+    const __m512i LO = _mm512_set1_epi32(lo), HI = _mm512_set1_epi32(hi);
+    int i(0);
+    for (; i+16<=n; i+=16) {
+        __m512i V = _mm512_loadu_si512(v+i);
+        _mm512_storeu_si512(v+i, _mm512_min_epi32(_mm512_max_epi32(V, LO), HI));
+    }
+    clamp_scalar(v+i, n-i, lo, hi);
+}
+
+__attribute__((target("avx512f")))
+inline void band_avx512(const int* x, const int* y, int n, Band band, int* mask) {
+    if (band.mode == BAND_ALL) {
+        std::fill(mask, mask+n, -1);
+        return;
+    }
+    const __m512 limit = _mm512_set1_ps(band.limit);
+    const __m512i ones = _mm512_set1_epi32(-1);
+    int i(0);
+    for (; i+16<=n; i+=16) {
+        __m512 X = _mm512_cvtepi32_ps(_mm512_loadu_si512(x+i));
+        __m512 Y = _mm512_cvtepi32_ps(_mm512_loadu_si512(y+i));
+        __mmask16 inside;
+        if (band.mode == BAND_BELOW) {
+            inside = _mm512_cmp_ps_mask(Y, limit, _CMP_LE_OQ);
+        }
+        else {
+            __m512 r2 = _mm512_add_ps(_mm512_mul_ps(X, X), _mm512_mul_ps(Y, Y));
+            inside = band.mode == BAND_INSIDE ? _mm512_cmp_ps_mask(r2, limit, _CMP_LE_OQ)
+                                              : _mm512_cmp_ps_mask(r2, limit, _CMP_GE_OQ);
+        }
+        _mm512_storeu_si512(mask+i, _mm512_maskz_mov_epi32(inside, ones));
+    }
+    band_scalar(x+i, y+i, n-i, band, mask+i);
+}
+
+#pragma GCC diagnostic pop
+
+#endif
+
+// Picks the widest kernels the CPU runs, DLA_SIMD=scalar|avx2|avx512 in the
+// environment forces a narrower one. All of them give the same result.
+inline const WalkerKernels& walker_kernels() {
+    static const WalkerKernels scalar {"scalar", step_scalar, clamp_scalar, band_scalar};
+#ifdef DLA_X86
+    static const WalkerKernels avx2 {"avx2", step_avx2, clamp_avx2, band_avx2};
+    static const WalkerKernels avx512 {"avx512", step_avx512, clamp_avx512, band_avx512};
+    static const WalkerKernels* chosen = [] {
+        const char* wanted = std::getenv("DLA_SIMD");
+        bool any = !wanted;
+        __builtin_cpu_init();
+        if ((any || !std::strcmp(wanted, "avx512")) && __builtin_cpu_supports("avx512f"))
+            return &avx512;
+        if ((any || std::strcmp(wanted, "scalar")) && __builtin_cpu_supports("avx2"))
+            return &avx2;
+        return &scalar;
+    }();
+    return *chosen;
+#else
+    return scalar;
+#endif
+}
+
+#endif
@@ -0,0 +1,86 @@
+/* Work-stealing pool for many independent tasks */
+
+#ifndef WORK_STEALING_H
+#define WORK_STEALING_H
+
+#include <thread>
+#include <mutex>
+#include <deque>
+#include <vector>
+#include <functional>
+
+// run(count, fn) calls fn(task, worker) once for every task in [0, count)
+// on n threads and returns when all are done.
+// The tasks are dealt out in contiguous blocks, one deque per worker. A
+// worker takes from the back of its own deque and, once it is empty,
+// steals from the front of the others, so the long tasks of one block get
+// spread over the idle workers. Tasks are expected to be coarse (a whole
+// simulation), a mutex per deque is cheap next to them.
+class WorkStealingPool {
+public:
+    WorkStealingPool(int n) : queues(n) {}
+
+    int size() const {
+        return (int)queues.size();
+    }
+
+    void run(int count, const std::function<void(int, int)>& fn) {
+        int n = size();
+        for (int w=0; w<n; w++) {
+            for (int t=count*w/n; t<count*(w+1)/n; t++) {
+                queues[w].tasks.push_back(t);
+            }
+        }
+        std::vector<std::thread> workers;
+        for (int w=1; w<n; w++) {
+            workers.emplace_back(&WorkStealingPool::work, this, w, std::cref(fn));
+        }
+        work(0, fn);
+        for (std::thread& t : workers) {
+            t.join();
+        }
+    }
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<int> tasks;
+    };
+
+    bool pop(int worker, int& task) {
+        Queue& q = queues[worker];
+        std::lock_guard<std::mutex> lock(q.mutex);
+        if (q.tasks.empty())
+            return false;
+        task = q.tasks.back();
+        q.tasks.pop_back();
+        return true;
+    }
+
+    bool steal(int thief, int& task) {
+        int n = size();
+        for (int i=1; i<n; i++) {
+            Queue& q = queues[(thief+i) % n];
+            std::lock_guard<std::mutex> lock(q.mutex);
+            if (!q.tasks.empty()) {
+                task = q.tasks.front();
+                q.tasks.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // no task is ever added while running, so once every deque is empty
+    // the worker is done
+    void work(int worker, const std::function<void(int, int)>& fn) {
+        int task;
+        while (pop(worker, task) || steal(worker, task)) {
+            fn(task, worker);
+        }
+    }
+
+    std::vector<Queue> queues;
+};
+
+#endif